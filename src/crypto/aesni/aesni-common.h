@@ -0,0 +1,84 @@
+#pragma once
+
+// Shared pieces of the AES-NI backend: intrinsics, per-function target
+// attributes (so the rest of the build needs no -maes/-mavx512 flags) and
+// CPUID probing used for runtime dispatch.
+
+#include <cstdint>
+#include <cstring>
+
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define AESNI_TARGET
+#define VAES_TARGET
+#else
+#include <cpuid.h>
+#define AESNI_TARGET __attribute__((target("aes,sse4.1")))
+#define VAES_TARGET __attribute__((target("aes,avx512f,vaes")))
+#endif
+
+#define ALIGN16 alignas(16)
+
+namespace aesni {
+
+inline void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4])
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuidex(info, int(leaf), int(subleaf));
+    for (int i = 0; i < 4; ++i)
+        regs[i] = unsigned(info[i]);
+#else
+    if (!__get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3]))
+        regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#endif
+}
+
+inline unsigned long long xgetbv0()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _xgetbv(0);
+#else
+    unsigned eax = 0, edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+inline const __m128i *roundKeys(const char *key)
+{
+    return reinterpret_cast<const __m128i *>(key);
+}
+
+} // namespace aesni
+
+/// CPUID.1:ECX.AES[bit 25].
+inline bool check_aesni_support()
+{
+    static const bool supported = [] {
+        unsigned regs[4];
+        aesni::cpuid(1, 0, regs);
+        return (regs[2] & (1u << 25)) != 0;
+    }();
+    return supported;
+}
+
+/// VAES on 512-bit registers: CPU support plus OS-enabled ZMM/opmask state.
+inline bool check_vaes_support()
+{
+    static const bool supported = [] {
+        if (!check_aesni_support())
+            return false;
+        unsigned regs[4];
+        aesni::cpuid(1, 0, regs);
+        const bool osxsave = (regs[2] & (1u << 27)) != 0;
+        if (!osxsave || (aesni::xgetbv0() & 0xE6) != 0xE6)
+            return false;
+        aesni::cpuid(7, 0, regs);
+        const bool avx512f = (regs[1] & (1u << 16)) != 0;
+        const bool vaes = (regs[2] & (1u << 9)) != 0;
+        return avx512f && vaes;
+    }();
+    return supported;
+}
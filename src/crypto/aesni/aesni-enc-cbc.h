@@ -0,0 +1,60 @@
+#pragma once
+
+// CBC with AES-NI. Encryption is inherently serial; decryption of large
+// inputs goes through VAES when the CPU has it.
+
+#include "aesni-common.h"
+#include "aesni-enc-ecb.h"
+#include "aesni-vaes.h"
+
+AESNI_TARGET inline void AES_CBC_encrypt(const unsigned char *in, unsigned char *out, const unsigned char *ivec,
+                                         unsigned long length, const char *key, int number_of_rounds)
+{
+    __m128i feedback = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ivec));
+    for (unsigned long i = 0; i + 16 <= length; i += 16) {
+        const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        feedback = AES_encrypt_block(_mm_xor_si128(data, feedback), key, number_of_rounds);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), feedback);
+    }
+}
+
+/// @p key is the AES_set_decrypt_key schedule. Safe for in == out.
+AESNI_TARGET inline void AES_CBC_decrypt(const unsigned char *in, unsigned char *out, const unsigned char *ivec,
+                                         unsigned long length, const char *key, int number_of_rounds)
+{
+    __m128i feedback = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ivec));
+    unsigned long done = check_vaes_support()
+        ? aesni::VAES_CBC_decrypt(in, out, feedback, length, key, number_of_rounds)
+        : 0;
+
+    // AESDEC has a latency of several cycles but a throughput of one per
+    // cycle, so eight independent blocks keep the unit busy.
+    const __m128i *rk = aesni::roundKeys(key);
+    for (; done + 128 <= length; done += 128) {
+        __m128i c[8], b[8];
+        const __m128i firstKey = _mm_loadu_si128(rk);
+        for (int k = 0; k < 8; ++k) {
+            c[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + done) + k);
+            b[k] = _mm_xor_si128(c[k], firstKey);
+        }
+        for (int j = 1; j < number_of_rounds; ++j) {
+            const __m128i roundKey = _mm_loadu_si128(rk + j);
+            for (int k = 0; k < 8; ++k)
+                b[k] = _mm_aesdec_si128(b[k], roundKey);
+        }
+        const __m128i lastKey = _mm_loadu_si128(rk + number_of_rounds);
+        b[0] = _mm_xor_si128(_mm_aesdeclast_si128(b[0], lastKey), feedback);
+        for (int k = 1; k < 8; ++k)
+            b[k] = _mm_xor_si128(_mm_aesdeclast_si128(b[k], lastKey), c[k - 1]);
+        for (int k = 0; k < 8; ++k)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + done) + k, b[k]);
+        feedback = c[7];
+    }
+
+    for (; done + 16 <= length; done += 16) {
+        const __m128i last_in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + done));
+        const __m128i data = AES_decrypt_block(last_in, key, number_of_rounds);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + done), _mm_xor_si128(data, feedback));
+        feedback = last_in;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// CFB-128 and OFB with AES-NI. Both only ever run the forward cipher, so
+// they take the AES_set_encrypt_key schedule in either direction.
+
+#include "aesni-common.h"
+#include "aesni-enc-ecb.h"
+
+AESNI_TARGET inline void AES_CFB_encrypt(const unsigned char *in, unsigned char *out, const unsigned char *ivec,
+                                         unsigned long length, const char *key, int number_of_rounds)
+{
+    __m128i feedback = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ivec));
+    for (unsigned long i = 0; i + 16 <= length; i += 16) {
+        const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        feedback = _mm_xor_si128(data, AES_encrypt_block(feedback, key, number_of_rounds));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), feedback);
+    }
+}
+
+AESNI_TARGET inline void AES_CFB_decrypt(const unsigned char *in, unsigned char *out, const unsigned char *ivec,
+                                         unsigned long length, const char *key, int number_of_rounds)
+{
+    // The keystream only depends on ciphertext, so four blocks run in parallel.
+    __m128i feedback = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ivec));
+    const __m128i *rk = aesni::roundKeys(key);
+    unsigned long i = 0;
+    for (; i + 64 <= length; i += 64) {
+        __m128i c[4], b[4];
+        for (int k = 0; k < 4; ++k)
+            c[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i) + k);
+        b[0] = _mm_xor_si128(feedback, _mm_loadu_si128(rk));
+        for (int k = 1; k < 4; ++k)
+            b[k] = _mm_xor_si128(c[k - 1], _mm_loadu_si128(rk));
+        for (int j = 1; j < number_of_rounds; ++j) {
+            const __m128i roundKey = _mm_loadu_si128(rk + j);
+            for (int k = 0; k < 4; ++k)
+                b[k] = _mm_aesenc_si128(b[k], roundKey);
+        }
+        const __m128i lastKey = _mm_loadu_si128(rk + number_of_rounds);
+        for (int k = 0; k < 4; ++k)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i) + k,
+                             _mm_xor_si128(c[k], _mm_aesenclast_si128(b[k], lastKey)));
+        feedback = c[3];
+    }
+    for (; i + 16 <= length; i += 16) {
+        const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                         _mm_xor_si128(data, AES_encrypt_block(feedback, key, number_of_rounds)));
+        feedback = data;
+    }
+}
+
+/// OFB is symmetric: the same call encrypts and decrypts.
+AESNI_TARGET inline void AES_OFB_crypt(const unsigned char *in, unsigned char *out, const unsigned char *ivec,
+                                       unsigned long length, const char *key, int number_of_rounds)
+{
+    __m128i keystream = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ivec));
+    for (unsigned long i = 0; i + 16 <= length; i += 16) {
+        keystream = AES_encrypt_block(keystream, key, number_of_rounds);
+        const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_xor_si128(data, keystream));
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+// ECB with AES-NI; large inputs go through VAES when the CPU has it.
+
+#include "aesni-common.h"
+#include "aesni-vaes.h"
+
+AESNI_TARGET inline __m128i AES_encrypt_block(__m128i block, const char *key, int number_of_rounds)
+{
+    const __m128i *rk = aesni::roundKeys(key);
+    block = _mm_xor_si128(block, _mm_loadu_si128(rk));
+    for (int j = 1; j < number_of_rounds; ++j)
+        block = _mm_aesenc_si128(block, _mm_loadu_si128(rk + j));
+    return _mm_aesenclast_si128(block, _mm_loadu_si128(rk + number_of_rounds));
+}
+
+AESNI_TARGET inline __m128i AES_decrypt_block(__m128i block, const char *key, int number_of_rounds)
+{
+    const __m128i *rk = aesni::roundKeys(key);
+    block = _mm_xor_si128(block, _mm_loadu_si128(rk));
+    for (int j = 1; j < number_of_rounds; ++j)
+        block = _mm_aesdec_si128(block, _mm_loadu_si128(rk + j));
+    return _mm_aesdeclast_si128(block, _mm_loadu_si128(rk + number_of_rounds));
+}
+
+AESNI_TARGET inline void AES_ECB_encrypt(const unsigned char *in, unsigned char *out,
+                                         unsigned long length, const char *key, int number_of_rounds)
+{
+    unsigned long done = check_vaes_support() ? aesni::VAES_ECB_encrypt(in, out, length, key, number_of_rounds) : 0;
+    for (; done + 16 <= length; done += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + done));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + done), AES_encrypt_block(block, key, number_of_rounds));
+    }
+}
+
+/// @p key is the AES_set_decrypt_key schedule.
+AESNI_TARGET inline void AES_ECB_decrypt(const unsigned char *in, unsigned char *out,
+                                         unsigned long length, const char *key, int number_of_rounds)
+{
+    unsigned long done = check_vaes_support() ? aesni::VAES_ECB_decrypt(in, out, length, key, number_of_rounds) : 0;
+    for (; done + 16 <= length; done += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + done));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + done), AES_decrypt_block(block, key, number_of_rounds));
+    }
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+// Key expansion with AESKEYGENASSIST, after the Intel AES-NI white paper.
+// The resulting schedule is byte-identical to the FIPS-197 one.
+
+#include "aesni-common.h"
+
+AESNI_TARGET inline __m128i AES_128_ASSIST(__m128i temp1, __m128i temp2)
+{
+    __m128i temp3;
+    temp2 = _mm_shuffle_epi32(temp2, 0xff);
+    temp3 = _mm_slli_si128(temp1, 0x4);
+    temp1 = _mm_xor_si128(temp1, temp3);
+    temp3 = _mm_slli_si128(temp3, 0x4);
+    temp1 = _mm_xor_si128(temp1, temp3);
+    temp3 = _mm_slli_si128(temp3, 0x4);
+    temp1 = _mm_xor_si128(temp1, temp3);
+    temp1 = _mm_xor_si128(temp1, temp2);
+    return temp1;
+}
+
+AESNI_TARGET inline void AES_128_Key_Expansion(const unsigned char *userkey, unsigned char *key)
+{
+    __m128i temp1, temp2;
+    __m128i *Key_Schedule = reinterpret_cast<__m128i *>(key);
+
+    temp1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(userkey));
+    _mm_storeu_si128(&Key_Schedule[0], temp1);
+    temp2 = _mm_aeskeygenassist_si128(temp1, 0x1);
+    temp1 = AES_128_ASSIST(temp1, temp2);
+    _mm_storeu_si128(&Key_Schedule[1], temp1);
+    temp2 = _mm_aeskeygenassist_si128(temp1, 0x2);
+    temp1 = AES_128_ASSIST(temp1, temp2);
+    _mm_storeu_si128(&Key_Schedule[2], temp1);
+    temp2 = _mm_aeskeygenassist_si128(temp1, 0x4);
+    temp1 = AES_128_ASSIST(temp1, temp2);
+    _mm_storeu_si128(&Key_Schedule[3], temp1);
+    temp2 = _mm_aeskeygenassist_si128(temp1, 0x8);
+    temp1 = AES_128_ASSIST(temp1, temp2);
+    _mm_storeu_si128(&Key_Schedule[4], temp1);
+    temp2 = _mm_aeskeygenassist_si128(temp1, 0x10);
+    temp1 = AES_128_ASSIST(temp1, temp2);
+    _mm_storeu_si128(&Key_Schedule[5], temp1);
+    temp2 = _mm_aeskeygenassist_si128(temp1, 0x20);
+    temp1 = AES_128_ASSIST(temp1, temp2);
+    _mm_storeu_si128(&Key_Schedule[6], temp1);
+    temp2 = _mm_aeskeygenassist_si128(temp1, 0x40);
+    temp1 = AES_128_ASSIST(temp1, temp2);
+    _mm_storeu_si128(&Key_Schedule[7], temp1);
+    temp2 = _mm_aeskeygenassist_si128(temp1, 0x80);
+    temp1 = AES_128_ASSIST(temp1, temp2);
+    _mm_storeu_si128(&Key_Schedule[8], temp1);
+    temp2 = _mm_aeskeygenassist_si128(temp1, 0x1b);
+    temp1 = AES_128_ASSIST(temp1, temp2);
+    _mm_storeu_si128(&Key_Schedule[9], temp1);
+    temp2 = _mm_aeskeygenassist_si128(temp1, 0x36);
+    temp1 = AES_128_ASSIST(temp1, temp2);
+    _mm_storeu_si128(&Key_Schedule[10], temp1);
+}
+
+AESNI_TARGET inline void KEY_192_ASSIST(__m128i *temp1, __m128i *temp2, __m128i *temp3)
+{
+    __m128i temp4;
+    *temp2 = _mm_shuffle_epi32(*temp2, 0x55);
+    temp4 = _mm_slli_si128(*temp1, 0x4);
+    *temp1 = _mm_xor_si128(*temp1, temp4);
+    temp4 = _mm_slli_si128(temp4, 0x4);
+    *temp1 = _mm_xor_si128(*temp1, temp4);
+    temp4 = _mm_slli_si128(temp4, 0x4);
+    *temp1 = _mm_xor_si128(*temp1, temp4);
+    *temp1 = _mm_xor_si128(*temp1, *temp2);
+    *temp2 = _mm_shuffle_epi32(*temp1, 0xff);
+    temp4 = _mm_slli_si128(*temp3, 0x4);
+    *temp3 = _mm_xor_si128(*temp3, temp4);
+    *temp3 = _mm_xor_si128(*temp3, *temp2);
+}
+
+AESNI_TARGET inline __m128i AES_192_MERGE(__m128i low, __m128i high, int selector)
+{
+    return selector == 0
+        ? _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(low), _mm_castsi128_pd(high), 0))
+        : _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(low), _mm_castsi128_pd(high), 1));
+}
+
+AESNI_TARGET inline void AES_192_Key_Expansion(const unsigned char *userkey, unsigned char *key)
+{
+    __m128i temp1, temp2, temp3;
+    __m128i Key_Schedule[13];
+
+    // The white paper loads 16 bytes at userkey+16; copy first so we never
+    // read past the 24-byte key.
+    ALIGN16 unsigned char tail[16] = {};
+    std::memcpy(tail, userkey + 16, 8);
+
+    temp1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(userkey));
+    temp3 = _mm_load_si128(reinterpret_cast<const __m128i *>(tail));
+    Key_Schedule[0] = temp1;
+    Key_Schedule[1] = temp3;
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x1);
+    KEY_192_ASSIST(&temp1, &temp2, &temp3);
+    Key_Schedule[1] = AES_192_MERGE(Key_Schedule[1], temp1, 0);
+    Key_Schedule[2] = AES_192_MERGE(temp1, temp3, 1);
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x2);
+    KEY_192_ASSIST(&temp1, &temp2, &temp3);
+    Key_Schedule[3] = temp1;
+    Key_Schedule[4] = temp3;
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x4);
+    KEY_192_ASSIST(&temp1, &temp2, &temp3);
+    Key_Schedule[4] = AES_192_MERGE(Key_Schedule[4], temp1, 0);
+    Key_Schedule[5] = AES_192_MERGE(temp1, temp3, 1);
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x8);
+    KEY_192_ASSIST(&temp1, &temp2, &temp3);
+    Key_Schedule[6] = temp1;
+    Key_Schedule[7] = temp3;
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x10);
+    KEY_192_ASSIST(&temp1, &temp2, &temp3);
+    Key_Schedule[7] = AES_192_MERGE(Key_Schedule[7], temp1, 0);
+    Key_Schedule[8] = AES_192_MERGE(temp1, temp3, 1);
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x20);
+    KEY_192_ASSIST(&temp1, &temp2, &temp3);
+    Key_Schedule[9] = temp1;
+    Key_Schedule[10] = temp3;
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x40);
+    KEY_192_ASSIST(&temp1, &temp2, &temp3);
+    Key_Schedule[10] = AES_192_MERGE(Key_Schedule[10], temp1, 0);
+    Key_Schedule[11] = AES_192_MERGE(temp1, temp3, 1);
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x80);
+    KEY_192_ASSIST(&temp1, &temp2, &temp3);
+    Key_Schedule[12] = temp1;
+
+    for (int i = 0; i < 13; ++i)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(key) + i, Key_Schedule[i]);
+}
+
+AESNI_TARGET inline void KEY_256_ASSIST_1(__m128i *temp1, __m128i *temp2)
+{
+    __m128i temp4;
+    *temp2 = _mm_shuffle_epi32(*temp2, 0xff);
+    temp4 = _mm_slli_si128(*temp1, 0x4);
+    *temp1 = _mm_xor_si128(*temp1, temp4);
+    temp4 = _mm_slli_si128(temp4, 0x4);
+    *temp1 = _mm_xor_si128(*temp1, temp4);
+    temp4 = _mm_slli_si128(temp4, 0x4);
+    *temp1 = _mm_xor_si128(*temp1, temp4);
+    *temp1 = _mm_xor_si128(*temp1, *temp2);
+}
+
+AESNI_TARGET inline void KEY_256_ASSIST_2(__m128i *temp1, __m128i *temp3)
+{
+    __m128i temp2, temp4;
+    temp4 = _mm_aeskeygenassist_si128(*temp1, 0x0);
+    temp2 = _mm_shuffle_epi32(temp4, 0xaa);
+    temp4 = _mm_slli_si128(*temp3, 0x4);
+    *temp3 = _mm_xor_si128(*temp3, temp4);
+    temp4 = _mm_slli_si128(temp4, 0x4);
+    *temp3 = _mm_xor_si128(*temp3, temp4);
+    temp4 = _mm_slli_si128(temp4, 0x4);
+    *temp3 = _mm_xor_si128(*temp3, temp4);
+    *temp3 = _mm_xor_si128(*temp3, temp2);
+}
+
+AESNI_TARGET inline void AES_256_Key_Expansion(const unsigned char *userkey, unsigned char *key)
+{
+    __m128i temp1, temp2, temp3;
+    __m128i *Key_Schedule = reinterpret_cast<__m128i *>(key);
+
+    temp1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(userkey));
+    temp3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(userkey + 16));
+    _mm_storeu_si128(&Key_Schedule[0], temp1);
+    _mm_storeu_si128(&Key_Schedule[1], temp3);
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x01);
+    KEY_256_ASSIST_1(&temp1, &temp2);
+    _mm_storeu_si128(&Key_Schedule[2], temp1);
+    KEY_256_ASSIST_2(&temp1, &temp3);
+    _mm_storeu_si128(&Key_Schedule[3], temp3);
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x02);
+    KEY_256_ASSIST_1(&temp1, &temp2);
+    _mm_storeu_si128(&Key_Schedule[4], temp1);
+    KEY_256_ASSIST_2(&temp1, &temp3);
+    _mm_storeu_si128(&Key_Schedule[5], temp3);
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x04);
+    KEY_256_ASSIST_1(&temp1, &temp2);
+    _mm_storeu_si128(&Key_Schedule[6], temp1);
+    KEY_256_ASSIST_2(&temp1, &temp3);
+    _mm_storeu_si128(&Key_Schedule[7], temp3);
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x08);
+    KEY_256_ASSIST_1(&temp1, &temp2);
+    _mm_storeu_si128(&Key_Schedule[8], temp1);
+    KEY_256_ASSIST_2(&temp1, &temp3);
+    _mm_storeu_si128(&Key_Schedule[9], temp3);
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x10);
+    KEY_256_ASSIST_1(&temp1, &temp2);
+    _mm_storeu_si128(&Key_Schedule[10], temp1);
+    KEY_256_ASSIST_2(&temp1, &temp3);
+    _mm_storeu_si128(&Key_Schedule[11], temp3);
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x20);
+    KEY_256_ASSIST_1(&temp1, &temp2);
+    _mm_storeu_si128(&Key_Schedule[12], temp1);
+    KEY_256_ASSIST_2(&temp1, &temp3);
+    _mm_storeu_si128(&Key_Schedule[13], temp3);
+    temp2 = _mm_aeskeygenassist_si128(temp3, 0x40);
+    KEY_256_ASSIST_1(&temp1, &temp2);
+    _mm_storeu_si128(&Key_Schedule[14], temp1);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// OpenSSL-style key setup on top of the AES-NI key expansion.
+
+#include "aesni-common.h"
+#include "aesni-key-exp.h"
+
+typedef struct KEY_SCHEDULE {
+    ALIGN16 unsigned char KEY[16 * 15];
+    unsigned int nr;
+} AES_KEY;
+
+inline int AES_set_encrypt_key(const unsigned char *userKey, const int bits, AES_KEY *key)
+{
+    if (!userKey || !key)
+        return -1;
+
+    switch (bits) {
+    case 128:
+        AES_128_Key_Expansion(userKey, key->KEY);
+        key->nr = 10;
+        return 0;
+    case 192:
+        AES_192_Key_Expansion(userKey, key->KEY);
+        key->nr = 12;
+        return 0;
+    case 256:
+        AES_256_Key_Expansion(userKey, key->KEY);
+        key->nr = 14;
+        return 0;
+    default:
+        return -2;
+    }
+}
+
+/// Decryption schedule for AESDEC: round keys reversed, inner ones through AESIMC.
+AESNI_TARGET inline int AES_set_decrypt_key(const unsigned char *userKey, const int bits, AES_KEY *key)
+{
+    AES_KEY temp_key;
+    const int status = AES_set_encrypt_key(userKey, bits, &temp_key);
+    if (status != 0)
+        return status;
+
+    const int nr = int(temp_key.nr);
+    const __m128i *enc = reinterpret_cast<const __m128i *>(temp_key.KEY);
+    __m128i *dec = reinterpret_cast<__m128i *>(key->KEY);
+
+    _mm_store_si128(&dec[0], _mm_load_si128(&enc[nr]));
+    for (int i = 1; i < nr; ++i)
+        _mm_store_si128(&dec[i], _mm_aesimc_si128(_mm_load_si128(&enc[nr - i])));
+    _mm_store_si128(&dec[nr], _mm_load_si128(&enc[0]));
+
+    key->nr = temp_key.nr;
+    std::memset(temp_key.KEY, 0, sizeof(temp_key.KEY));
+    return 0;
+}
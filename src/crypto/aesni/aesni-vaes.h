@@ -0,0 +1,94 @@
+#pragma once
+
+// VAES paths: four AES blocks per 512-bit register, four registers in flight.
+// Each function handles whole 256-byte groups and returns how
+// many bytes it consumed; the caller finishes the tail with 128-bit AES-NI.
+
+#include "aesni-common.h"
+
+namespace aesni {
+
+constexpr unsigned long kVaesGroupBytes = 256;
+
+VAES_TARGET inline void broadcastRoundKeys(const char *key, int number_of_rounds, __m512i *out)
+{
+    const __m128i *rk = roundKeys(key);
+    for (int j = 0; j <= number_of_rounds; ++j)
+        out[j] = _mm512_broadcast_i32x4(_mm_loadu_si128(rk + j));
+}
+
+VAES_TARGET inline unsigned long VAES_ECB_encrypt(const unsigned char *in, unsigned char *out,
+                                                  unsigned long length, const char *key, int number_of_rounds)
+{
+    __m512i rk[15];
+    broadcastRoundKeys(key, number_of_rounds, rk);
+
+    unsigned long done = 0;
+    for (; done + kVaesGroupBytes <= length; done += kVaesGroupBytes) {
+        __m512i b[4];
+        for (int k = 0; k < 4; ++k)
+            b[k] = _mm512_xor_si512(_mm512_loadu_si512(in + done + 64 * k), rk[0]);
+        for (int j = 1; j < number_of_rounds; ++j)
+            for (int k = 0; k < 4; ++k)
+                b[k] = _mm512_aesenc_epi128(b[k], rk[j]);
+        for (int k = 0; k < 4; ++k)
+            _mm512_storeu_si512(out + done + 64 * k, _mm512_aesenclast_epi128(b[k], rk[number_of_rounds]));
+    }
+    return done;
+}
+
+VAES_TARGET inline unsigned long VAES_ECB_decrypt(const unsigned char *in, unsigned char *out,
+                                                  unsigned long length, const char *key, int number_of_rounds)
+{
+    __m512i rk[15];
+    broadcastRoundKeys(key, number_of_rounds, rk);
+
+    unsigned long done = 0;
+    for (; done + kVaesGroupBytes <= length; done += kVaesGroupBytes) {
+        __m512i b[4];
+        for (int k = 0; k < 4; ++k)
+            b[k] = _mm512_xor_si512(_mm512_loadu_si512(in + done + 64 * k), rk[0]);
+        for (int j = 1; j < number_of_rounds; ++j)
+            for (int k = 0; k < 4; ++k)
+                b[k] = _mm512_aesdec_epi128(b[k], rk[j]);
+        for (int k = 0; k < 4; ++k)
+            _mm512_storeu_si512(out + done + 64 * k, _mm512_aesdeclast_epi128(b[k], rk[number_of_rounds]));
+    }
+    return done;
+}
+
+/// CBC decryption of whole 256-byte groups; @p feedback holds the previous
+/// ciphertext block and is updated. Safe for in == out.
+VAES_TARGET inline unsigned long VAES_CBC_decrypt(const unsigned char *in, unsigned char *out, __m128i &feedback,
+                                                  unsigned long length, const char *key, int number_of_rounds)
+{
+    __m512i rk[15];
+    broadcastRoundKeys(key, number_of_rounds, rk);
+
+    // Lane 3 of "carry" is the ciphertext block preceding the current group.
+    __m512i carry = _mm512_inserti32x4(_mm512_setzero_si512(), feedback, 3);
+    unsigned long done = 0;
+    for (; done + kVaesGroupBytes <= length; done += kVaesGroupBytes) {
+        __m512i c[4], b[4];
+        for (int k = 0; k < 4; ++k) {
+            c[k] = _mm512_loadu_si512(in + done + 64 * k);
+            b[k] = _mm512_xor_si512(c[k], rk[0]);
+        }
+        for (int j = 1; j < number_of_rounds; ++j)
+            for (int k = 0; k < 4; ++k)
+                b[k] = _mm512_aesdec_epi128(b[k], rk[j]);
+        for (int k = 0; k < 4; ++k) {
+            // [prev.block3, c.block0, c.block1, c.block2] = chaining values for c.
+            const __m512i prev = _mm512_alignr_epi64(c[k], k == 0 ? carry : c[k - 1], 6);
+            b[k] = _mm512_xor_si512(_mm512_aesdeclast_epi128(b[k], rk[number_of_rounds]), prev);
+        }
+        carry = c[3];
+        for (int k = 0; k < 4; ++k)
+            _mm512_storeu_si512(out + done + 64 * k, b[k]);
+    }
+    if (done)
+        feedback = _mm512_extracti32x4_epi32(carry, 3);
+    return done;
+}
+
+} // namespace aesni
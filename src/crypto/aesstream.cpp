@@ -0,0 +1,143 @@
+#include "aesstream.h"
+
+#include <cstring>
+
+namespace crypto {
+
+CbcStreamDecryptor::CbcStreamDecryptor(const QAESKeySchedule &schedule, const QByteArray &iv)
+    : m_cipher(schedule.level(), QAESEncryption::CBC, QAESEncryption::PKCS7)
+    , m_schedule(schedule)
+    , m_error(!schedule.isValid() || iv.size() != kBlockSize)
+{
+    if (!m_error)
+        std::memcpy(m_feedback, iv.constData(), kBlockSize);
+}
+
+bool CbcStreamDecryptor::decryptBlocks(const quint8 *in, qsizetype length, QByteArray &plain)
+{
+    const qsizetype start = plain.size();
+    plain.resize(start + length);
+    if (!m_cipher.decrypt(m_schedule, in, reinterpret_cast<quint8 *>(plain.data()) + start, length, m_feedback)) {
+        m_error = true;
+        return false;
+    }
+    std::memcpy(m_feedback, in + length - kBlockSize, kBlockSize);
+    return true;
+}
+
+bool CbcStreamDecryptor::feed(QByteArrayView cipher, QByteArray &plain)
+{
+    if (m_error)
+        return false;
+
+    const auto *data = reinterpret_cast<const quint8 *>(cipher.data());
+    qsizetype size = cipher.size();
+
+    // Only flush the held-back block once more ciphertext proves it is not the last one.
+    if (m_pendingSize + size <= kBlockSize) {
+        std::memcpy(m_pending + m_pendingSize, data, size_t(size));
+        m_pendingSize += int(size);
+        return true;
+    }
+    if (m_pendingSize > 0) {
+        const int take = kBlockSize - m_pendingSize;
+        std::memcpy(m_pending + m_pendingSize, data, size_t(take));
+        data += take;
+        size -= take;
+        m_pendingSize = 0;
+        if (!decryptBlocks(m_pending, kBlockSize, plain))
+            return false;
+    }
+
+    // size > 0 here; keep between 1 and 16 bytes back for the next call or finish().
+    const qsizetype bulk = ((size - 1) / kBlockSize) * kBlockSize;
+    if (bulk > 0 && !decryptBlocks(data, bulk, plain))
+        return false;
+    m_pendingSize = int(size - bulk);
+    std::memcpy(m_pending, data + bulk, size_t(m_pendingSize));
+    return true;
+}
+
+bool CbcStreamDecryptor::finish(QByteArray &plain)
+{
+    if (m_error || m_pendingSize != kBlockSize)
+        return false;
+
+    quint8 block[kBlockSize];
+    if (!m_cipher.decrypt(m_schedule, m_pending, block, kBlockSize, m_feedback))
+        return false;
+    m_pendingSize = 0;
+
+    const int padding = block[kBlockSize - 1];
+    if (padding < 1 || padding > kBlockSize)
+        return false;
+    for (int i = kBlockSize - padding; i < kBlockSize; ++i) {
+        if (block[i] != padding)
+            return false;
+    }
+    plain.append(reinterpret_cast<const char *>(block), kBlockSize - padding);
+    return true;
+}
+
+CbcStreamEncryptor::CbcStreamEncryptor(const QAESKeySchedule &schedule, const QByteArray &iv)
+    : m_cipher(schedule.level(), QAESEncryption::CBC, QAESEncryption::PKCS7)
+    , m_schedule(schedule)
+    , m_error(!schedule.isValid() || iv.size() != kBlockSize)
+{
+    if (!m_error)
+        std::memcpy(m_feedback, iv.constData(), kBlockSize);
+}
+
+bool CbcStreamEncryptor::encryptBlocks(const quint8 *in, qsizetype length, QByteArray &cipher)
+{
+    const qsizetype start = cipher.size();
+    cipher.resize(start + length);
+    auto *out = reinterpret_cast<quint8 *>(cipher.data()) + start;
+    if (!m_cipher.encrypt(m_schedule, in, out, length, m_feedback)) {
+        m_error = true;
+        return false;
+    }
+    std::memcpy(m_feedback, out + length - kBlockSize, kBlockSize);
+    return true;
+}
+
+bool CbcStreamEncryptor::feed(QByteArrayView plain, QByteArray &cipher)
+{
+    if (m_error)
+        return false;
+
+    const auto *data = reinterpret_cast<const quint8 *>(plain.data());
+    qsizetype size = plain.size();
+    if (m_pendingSize > 0) {
+        const int take = int(qMin<qsizetype>(kBlockSize - m_pendingSize, size));
+        std::memcpy(m_pending + m_pendingSize, data, size_t(take));
+        m_pendingSize += take;
+        data += take;
+        size -= take;
+        if (m_pendingSize < kBlockSize)
+            return true;
+        m_pendingSize = 0;
+        if (!encryptBlocks(m_pending, kBlockSize, cipher))
+            return false;
+    }
+
+    const qsizetype bulk = size / kBlockSize * kBlockSize;
+    if (bulk > 0 && !encryptBlocks(data, bulk, cipher))
+        return false;
+    m_pendingSize = int(size - bulk);
+    std::memcpy(m_pending, data + bulk, size_t(m_pendingSize));
+    return true;
+}
+
+bool CbcStreamEncryptor::finish(QByteArray &cipher)
+{
+    if (m_error)
+        return false;
+    // PKCS#7 always pads, a whole block of 16s when the input was block-aligned.
+    const int padding = kBlockSize - m_pendingSize;
+    std::memset(m_pending + m_pendingSize, padding, size_t(padding));
+    m_pendingSize = 0;
+    return encryptBlocks(m_pending, kBlockSize, cipher);
+}
+
+} // namespace crypto
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "qaesencryption.h"
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+namespace crypto {
+
+/// Decrypts AES-CBC with PKCS#7 padding piece by piece. The last ciphertext block
+/// is held back until finish(), so only the padding decides where the message ends.
+class CbcStreamDecryptor
+{
+public:
+    /// @p schedule must outlive the decryptor.
+    CbcStreamDecryptor(const QAESKeySchedule &schedule, const QByteArray &iv);
+
+    /// Decrypts every complete block of @p cipher but the last and appends it to @p plain.
+    bool feed(QByteArrayView cipher, QByteArray &plain);
+    /// Decrypts the held-back block and appends it without padding.
+    /// False for empty or truncated input and for malformed padding.
+    bool finish(QByteArray &plain);
+
+private:
+    static constexpr int kBlockSize = 16;
+
+    bool decryptBlocks(const quint8 *in, qsizetype length, QByteArray &plain);
+
+    QAESEncryption m_cipher;
+    const QAESKeySchedule &m_schedule;
+    quint8 m_feedback[kBlockSize] = {};
+    quint8 m_pending[kBlockSize] = {};
+    int m_pendingSize = 0;
+    bool m_error = false;
+};
+
+/// Encrypts AES-CBC with PKCS#7 padding piece by piece; the output matches
+/// QAESEncryption::Crypt() over the concatenated input.
+class CbcStreamEncryptor
+{
+public:
+    /// @p schedule must outlive the encryptor.
+    CbcStreamEncryptor(const QAESKeySchedule &schedule, const QByteArray &iv);
+
+    /// Encrypts every complete block of @p plain and appends it to @p cipher; a partial
+    /// block is kept for the next call.
+    bool feed(QByteArrayView plain, QByteArray &cipher);
+    /// Pads the kept bytes and appends the last block.
+    bool finish(QByteArray &cipher);
+
+private:
+    static constexpr int kBlockSize = 16;
+
+    bool encryptBlocks(const quint8 *in, qsizetype length, QByteArray &cipher);
+
+    QAESEncryption m_cipher;
+    const QAESKeySchedule &m_schedule;
+    quint8 m_feedback[kBlockSize] = {};
+    quint8 m_pending[kBlockSize] = {};
+    int m_pendingSize = 0;
+    bool m_error = false;
+};
+
+} // namespace crypto
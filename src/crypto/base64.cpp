@@ -0,0 +1,390 @@
+#include "base64.h"
+
+#include <array>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+namespace crypto {
+namespace {
+
+constexpr char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+constexpr qint8 kInvalid = -1;
+constexpr qint8 kSkip = -2;
+constexpr qint8 kPad = -3;
+
+// SIMD kernels store a full vector per step, so output buffers carry this much slack.
+constexpr qsizetype kStoreSlack = 32;
+
+constexpr std::array<qint8, 256> makeDecodeTable()
+{
+    std::array<qint8, 256> table{};
+    for (auto &entry : table)
+        entry = kInvalid;
+    for (int i = 0; i < 64; ++i)
+        table[quint8(kAlphabet[i])] = qint8(i);
+    table['='] = kPad;
+    for (char c : {' ', '\t', '\r', '\n', '\v', '\f'})
+        table[quint8(c)] = kSkip;
+    return table;
+}
+
+constexpr std::array<qint8, 256> kDecodeTable = makeDecodeTable();
+
+inline void encodeTriple(const quint8 *in, char *out)
+{
+    const quint32 bits = (quint32(in[0]) << 16) | (quint32(in[1]) << 8) | in[2];
+    out[0] = kAlphabet[bits >> 18];
+    out[1] = kAlphabet[(bits >> 12) & 0x3f];
+    out[2] = kAlphabet[(bits >> 6) & 0x3f];
+    out[3] = kAlphabet[bits & 0x3f];
+}
+
+// Kernels consume whole vector-sized groups and return how many input bytes they
+// used. Decoders stop at the first group holding anything but alphabet characters
+// and leave it to the scalar loop.
+using EncodeKernel = qsizetype (*)(const quint8 *in, qsizetype length, char *out);
+using DecodeKernel = qsizetype (*)(const quint8 *in, qsizetype length, quint8 *out);
+
+qsizetype encodeScalar(const quint8 *, qsizetype, char *) { return 0; }
+qsizetype decodeScalar(const quint8 *, qsizetype, quint8 *) { return 0; }
+
+#ifdef BASE64_X86
+// Vector algorithms after W. Muła and D. Lemire, "Faster Base64 Encoding and
+// Decoding using AVX2 Instructions" (2018).
+
+#define BASE64_SSSE3_TARGET __attribute__((target("ssse3")))
+#define BASE64_AVX2_TARGET __attribute__((target("avx2")))
+
+// 12 input bytes, regrouped so that every 32-bit lane holds the 24 bits of one
+// output quadruple, become 16 six-bit indices.
+BASE64_SSSE3_TARGET inline __m128i splitSextets(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+BASE64_SSSE3_TARGET inline __m128i sextetsToAscii(__m128i indices)
+{
+    __m128i shift = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    shift = _mm_or_si128(shift, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i shiftLut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                           '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(shiftLut, shift), indices);
+}
+
+BASE64_SSSE3_TARGET qsizetype encodeSsse3(const quint8 *in, qsizetype length, char *out)
+{
+    qsizetype done = 0;
+    // Each step loads 16 bytes but consumes 12.
+    for (; done + 16 <= length; done += 12, out += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + done));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), sextetsToAscii(splitSextets(block)));
+    }
+    return done;
+}
+
+// Maps ASCII to sextets and reports in @p valid whether every byte was in the alphabet.
+BASE64_SSSE3_TARGET inline __m128i asciiToSextets(__m128i in, bool &valid)
+{
+    const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                        0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask2f = _mm_set1_epi8(0x2f);
+
+    const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask2f);
+    const __m128i loNibbles = _mm_and_si128(in, mask2f);
+    const __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+    const __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+    valid = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) == 0xffff;
+
+    const __m128i isSlash = _mm_cmpeq_epi8(in, mask2f);
+    const __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(isSlash, hiNibbles));
+    return _mm_add_epi8(in, roll);
+}
+
+// Packs 16 sextets into 12 bytes at the bottom of the register.
+BASE64_SSSE3_TARGET inline __m128i packSextets(__m128i sextets)
+{
+    const __m128i pairs = _mm_maddubs_epi16(sextets, _mm_set1_epi32(0x01400140));
+    const __m128i triples = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(triples, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+BASE64_SSSE3_TARGET qsizetype decodeSsse3(const quint8 *in, qsizetype length, quint8 *out)
+{
+    qsizetype done = 0;
+    for (; done + 16 <= length; done += 16, out += 12) {
+        bool valid = false;
+        const __m128i sextets = asciiToSextets(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + done)), valid);
+        if (!valid)
+            break;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), packSextets(sextets));
+    }
+    return done;
+}
+
+BASE64_AVX2_TARGET qsizetype encodeAvx2(const quint8 *in, qsizetype length, char *out)
+{
+    const __m256i regroup = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                             1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i shiftLut = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                              '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                              '/' - 63, 'A', 0, 0,
+                                              'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                              '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                              '/' - 63, 'A', 0, 0);
+    qsizetype done = 0;
+    // Two 12-byte groups per step, one per 128-bit lane; the second load reaches 28 bytes in.
+    for (; done + 28 <= length; done += 24, out += 32) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + done));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + done + 12));
+        __m256i block = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+        block = _mm256_shuffle_epi8(block, regroup);
+        const __m256i t0 = _mm256_and_si256(block, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(block, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(t1, t3);
+
+        __m256i shift = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        shift = _mm256_or_si256(shift, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        const __m256i ascii = _mm256_add_epi8(_mm256_shuffle_epi8(shiftLut, shift), indices);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), ascii);
+    }
+    return done + encodeSsse3(in + done, length - done, out);
+}
+
+BASE64_AVX2_TARGET qsizetype decodeAvx2(const quint8 *in, qsizetype length, quint8 *out)
+{
+    const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+                                           0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                           0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                             0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i mask2f = _mm256_set1_epi8(0x2f);
+
+    qsizetype done = 0;
+    for (; done + 32 <= length; done += 32, out += 24) {
+        const __m256i in32 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + done));
+        const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(in32, 4), mask2f);
+        const __m256i loNibbles = _mm256_and_si256(in32, mask2f);
+        const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+        const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+        if (!_mm256_testz_si256(lo, hi))
+            break;
+
+        const __m256i isSlash = _mm256_cmpeq_epi8(in32, mask2f);
+        const __m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(isSlash, hiNibbles));
+        const __m256i sextets = _mm256_add_epi8(in32, roll);
+
+        const __m256i pairs = _mm256_maddubs_epi16(sextets, _mm256_set1_epi32(0x01400140));
+        const __m256i triples = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+        const __m256i packed = _mm256_shuffle_epi8(triples, pack);
+        // 12 bytes sit at the bottom of each lane; close the gap between them.
+        const __m256i joined = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), joined);
+    }
+    return done + decodeSsse3(in + done, length - done, out);
+}
+#endif // BASE64_X86
+
+struct Base64Backend {
+    const char *name;
+    EncodeKernel encode;
+    DecodeKernel decode;
+};
+
+const Base64Backend &selectBackend()
+{
+    static const Base64Backend backend = []() -> Base64Backend {
+#ifdef BASE64_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return {"avx2", encodeAvx2, decodeAvx2};
+        }
+        if (__builtin_cpu_supports("ssse3")) {
+            return {"ssse3", encodeSsse3, decodeSsse3};
+        }
+#endif
+        return {"scalar", encodeScalar, decodeScalar};
+    }();
+    return backend;
+}
+
+// Encodes whole triples with the vector kernel first and the table for the rest;
+// returns the number of input bytes consumed (always a multiple of 3).
+qsizetype encodeTriples(const quint8 *in, qsizetype length, char *&out)
+{
+    qsizetype done = selectBackend().encode(in, length, out);
+    out += done / 3 * 4;
+    for (; done + 3 <= length; done += 3, out += 4)
+        encodeTriple(in + done, out);
+    return done;
+}
+
+void encodeTail(const quint8 *in, int length, char *out)
+{
+    const quint32 bits = (quint32(in[0]) << 16) | (length > 1 ? quint32(in[1]) << 8 : 0);
+    out[0] = kAlphabet[bits >> 18];
+    out[1] = kAlphabet[(bits >> 12) & 0x3f];
+    out[2] = length > 1 ? kAlphabet[(bits >> 6) & 0x3f] : '=';
+    out[3] = '=';
+}
+
+} // namespace
+
+QByteArray base64Encode(QByteArrayView data)
+{
+    const auto *in = reinterpret_cast<const quint8 *>(data.data());
+    const qsizetype encodedSize = (data.size() + 2) / 3 * 4;
+    QByteArray result(encodedSize + kStoreSlack, Qt::Uninitialized);
+    char *out = result.data();
+
+    const qsizetype done = encodeTriples(in, data.size(), out);
+    if (done < data.size())
+        encodeTail(in + done, int(data.size() - done), out);
+
+    result.truncate(encodedSize);
+    return result;
+}
+
+QByteArray base64Decode(QByteArrayView text, bool *ok)
+{
+    Base64Decoder decoder;
+    QByteArray result;
+    const bool decoded = decoder.feed(text, result) && decoder.finish(result);
+    if (ok)
+        *ok = decoded;
+    return decoded ? result : QByteArray();
+}
+
+const char *base64Backend()
+{
+    return selectBackend().name;
+}
+
+void Base64Encoder::feed(QByteArrayView input, QByteArray &output)
+{
+    const auto *in = reinterpret_cast<const quint8 *>(input.data());
+    qsizetype size = input.size();
+
+    const qsizetype start = output.size();
+    output.resize(start + (m_pendingSize + size) / 3 * 4 + kStoreSlack);
+    char *out = output.data() + start;
+
+    // Complete a triple left over from the previous call.
+    while (m_pendingSize > 0 && size > 0) {
+        if (m_pendingSize == 2) {
+            const quint8 triple[3] = {m_pending[0], m_pending[1], *in};
+            encodeTriple(triple, out);
+            out += 4;
+            m_pendingSize = 0;
+        } else {
+            m_pending[m_pendingSize++] = *in;
+        }
+        ++in;
+        --size;
+    }
+
+    const qsizetype done = encodeTriples(in, size, out);
+    for (qsizetype i = done; i < size; ++i)
+        m_pending[m_pendingSize++] = in[i];
+
+    output.truncate(out - output.constData());
+}
+
+void Base64Encoder::finish(QByteArray &output)
+{
+    if (m_pendingSize == 0)
+        return;
+    char tail[4];
+    encodeTail(m_pending, m_pendingSize, tail);
+    output.append(tail, 4);
+    m_pendingSize = 0;
+}
+
+bool Base64Decoder::feed(QByteArrayView input, QByteArray &output)
+{
+    if (m_error)
+        return false;
+
+    const qsizetype start = output.size();
+    output.resize(start + (input.size() / 4 + 1) * 3 + kStoreSlack);
+    auto *out = reinterpret_cast<quint8 *>(output.data()) + start;
+
+    const auto *data = reinterpret_cast<const quint8 *>(input.data());
+    const DecodeKernel kernel = selectBackend().decode;
+    qsizetype i = 0;
+    while (i < input.size()) {
+        // The vector path only runs on quadruple boundaries; whitespace or
+        // padding inside a vector drops to the table loop until realigned.
+        if (m_pendingChars == 0 && m_paddingChars == 0) {
+            const qsizetype consumed = kernel(data + i, input.size() - i, out);
+            i += consumed;
+            out += consumed / 4 * 3;
+            if (i == input.size())
+                break;
+        }
+
+        const qint8 value = kDecodeTable[data[i++]];
+        if (value >= 0 && m_paddingChars == 0) {
+            m_bits = (m_bits << 6) | quint32(value);
+            if (++m_pendingChars == 4) {
+                *out++ = quint8(m_bits >> 16);
+                *out++ = quint8(m_bits >> 8);
+                *out++ = quint8(m_bits);
+                m_bits = 0;
+                m_pendingChars = 0;
+            }
+        } else if (value == kPad && m_pendingChars >= 2 && m_pendingChars + m_paddingChars < 4) {
+            ++m_paddingChars;
+        } else if (value != kSkip) {
+            m_error = true;
+            break;
+        }
+    }
+
+    output.truncate(reinterpret_cast<const char *>(out) - output.constData());
+    return !m_error;
+}
+
+bool Base64Decoder::finish(QByteArray &output)
+{
+    // Padding, when present, must complete the quadruple exactly.
+    if (m_error || m_pendingChars == 1 || (m_paddingChars > 0 && m_pendingChars + m_paddingChars != 4)) {
+        m_error = true;
+        return false;
+    }
+    if (m_pendingChars == 2) {
+        output.append(char(m_bits >> 4));
+    } else if (m_pendingChars == 3) {
+        output.append(char(m_bits >> 10));
+        output.append(char(m_bits >> 2));
+    }
+    m_bits = 0;
+    m_pendingChars = 0;
+    return true;
+}
+
+} // namespace crypto
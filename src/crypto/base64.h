@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QtGlobal>
+
+namespace crypto {
+
+/// Standard-alphabet Base64 with '=' padding, the form QByteArray::toBase64() produces.
+QByteArray base64Encode(QByteArrayView data);
+
+/// Strict decode of a whole buffer: whitespace is skipped, any other character outside
+/// the alphabet or misplaced padding fails and sets @p ok to false.
+QByteArray base64Decode(QByteArrayView text, bool *ok = nullptr);
+
+/// Name of the SIMD backend picked for this CPU at runtime.
+const char *base64Backend();
+
+/// Incremental Base64 encoder; output matches base64Encode() over the concatenated input.
+class Base64Encoder
+{
+public:
+    /// Encodes @p input and appends the text to @p output.
+    void feed(QByteArrayView input, QByteArray &output);
+    /// Encodes the last one or two leftover bytes with padding.
+    void finish(QByteArray &output);
+
+private:
+    quint8 m_pending[2] = {};
+    int m_pendingSize = 0;
+};
+
+/// Incremental Base64 decoder for input that arrives in arbitrary pieces.
+/// Whitespace is skipped; anything else outside the alphabet is an error.
+class Base64Decoder
+{
+public:
+    /// Decodes @p input and appends the result to @p output.
+    bool feed(QByteArrayView input, QByteArray &output);
+    /// Flushes a trailing partial group. False if the input stopped mid-byte
+    /// or the padding does not match it.
+    bool finish(QByteArray &output);
+
+    bool hasError() const { return m_error; }
+
+private:
+    quint32 m_bits = 0;
+    int m_pendingChars = 0;
+    int m_paddingChars = 0;
+    bool m_error = false;
+};
+
+} // namespace crypto
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QByteArray>
+
+namespace crypto {
+
+/// AES-256 key the .enc ledgers are encrypted with.
+inline const QByteArray &ledgerKey()
+{
+    static const QByteArray key = QByteArray::fromHex(
+        "ab9f5f69737f3f02f1e2a6d17305eae239f2bba9d6a8ed5e322ad87d3654c9d8"
+    );
+    return key;
+}
+
+/// CBC initialisation vector used together with ledgerKey().
+inline const QByteArray &ledgerIv()
+{
+    static const QByteArray iv = QByteArray::fromHex("1af38c2dc2b96ffdd86694092341bc04");
+    return iv;
+}
+
+} // namespace crypto
@@ -0,0 +1,248 @@
+#include "md5batch.h"
+
+#include <QVector>
+
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MD5BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace crypto {
+namespace {
+
+constexpr quint32 kMd5Init[4] = {0x67452301u, 0xefcdab89u, 0x98badcfeu, 0x10325476u};
+
+quint32 loadLe32(const quint8 *bytes)
+{
+    return quint32(bytes[0]) | (quint32(bytes[1]) << 8) | (quint32(bytes[2]) << 16) | (quint32(bytes[3]) << 24);
+}
+
+void storeLe32(quint8 *bytes, quint32 value)
+{
+    bytes[0] = quint8(value);
+    bytes[1] = quint8(value >> 8);
+    bytes[2] = quint8(value >> 16);
+    bytes[3] = quint8(value >> 24);
+}
+
+qsizetype paddedBlockCount(qsizetype length)
+{
+    // Message + 0x80 marker + 64-bit bit length, rounded up to 64-byte blocks.
+    return (length + 8) / 64 + 1;
+}
+
+// Loads block @p blockIndex of the MD5-padded form of @p message as 16 little-endian words.
+void paddedBlock(QByteArrayView message, qsizetype blockIndex, quint32 words[16])
+{
+    const auto *data = reinterpret_cast<const quint8 *>(message.data());
+    const qsizetype length = message.size();
+    const qsizetype offset = blockIndex * 64;
+
+    if (offset + 64 <= length) {
+        for (int j = 0; j < 16; ++j) {
+            words[j] = loadLe32(data + offset + j * 4);
+        }
+        return;
+    }
+
+    quint8 tail[64] = {};
+    if (offset < length) {
+        std::memcpy(tail, data + offset, size_t(length - offset));
+    }
+    if (offset <= length) {
+        tail[length - offset] = 0x80;
+    }
+    if (blockIndex == paddedBlockCount(length) - 1) {
+        const quint64 bitLength = quint64(length) * 8;
+        storeLe32(tail + 56, quint32(bitLength));
+        storeLe32(tail + 60, quint32(bitLength >> 32));
+    }
+    for (int j = 0; j < 16; ++j) {
+        words[j] = loadLe32(tail + j * 4);
+    }
+}
+
+namespace scalar {
+
+using Vec = quint32;
+constexpr int kLanes = 1;
+#define MD5_LANES_TARGET
+
+inline Vec set1(quint32 value) { return value; }
+inline Vec load(const quint32 *src) { return *src; }
+inline void store(quint32 *dst, Vec value) { *dst = value; }
+inline Vec add(Vec a, Vec b) { return a + b; }
+inline Vec bitXor(Vec a, Vec b) { return a ^ b; }
+inline Vec bitAnd(Vec a, Vec b) { return a & b; }
+inline Vec bitOr(Vec a, Vec b) { return a | b; }
+inline Vec bitNot(Vec a) { return ~a; }
+inline Vec select(Vec mask, Vec a, Vec b) { return (a & mask) | (b & ~mask); }
+template<int Shift>
+inline Vec rotl(Vec a) { return (a << Shift) | (a >> (32 - Shift)); }
+
+#include "md5lanes.inc"
+#undef MD5_LANES_TARGET
+
+} // namespace scalar
+
+#ifdef MD5BATCH_X86
+namespace sse2 {
+
+using Vec = __m128i;
+constexpr int kLanes = 4;
+#define MD5_LANES_TARGET __attribute__((target("sse2")))
+
+MD5_LANES_TARGET inline Vec set1(quint32 value) { return _mm_set1_epi32(int(value)); }
+MD5_LANES_TARGET inline Vec load(const quint32 *src) { return _mm_load_si128(reinterpret_cast<const Vec *>(src)); }
+MD5_LANES_TARGET inline void store(quint32 *dst, Vec value) { _mm_store_si128(reinterpret_cast<Vec *>(dst), value); }
+MD5_LANES_TARGET inline Vec add(Vec a, Vec b) { return _mm_add_epi32(a, b); }
+MD5_LANES_TARGET inline Vec bitXor(Vec a, Vec b) { return _mm_xor_si128(a, b); }
+MD5_LANES_TARGET inline Vec bitAnd(Vec a, Vec b) { return _mm_and_si128(a, b); }
+MD5_LANES_TARGET inline Vec bitOr(Vec a, Vec b) { return _mm_or_si128(a, b); }
+MD5_LANES_TARGET inline Vec bitNot(Vec a) { return _mm_xor_si128(a, _mm_set1_epi32(-1)); }
+MD5_LANES_TARGET inline Vec select(Vec mask, Vec a, Vec b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+template<int Shift>
+MD5_LANES_TARGET inline Vec rotl(Vec a) { return _mm_or_si128(_mm_slli_epi32(a, Shift), _mm_srli_epi32(a, 32 - Shift)); }
+
+#include "md5lanes.inc"
+#undef MD5_LANES_TARGET
+
+} // namespace sse2
+
+namespace avx2 {
+
+using Vec = __m256i;
+constexpr int kLanes = 8;
+#define MD5_LANES_TARGET __attribute__((target("avx2")))
+
+MD5_LANES_TARGET inline Vec set1(quint32 value) { return _mm256_set1_epi32(int(value)); }
+MD5_LANES_TARGET inline Vec load(const quint32 *src) { return _mm256_load_si256(reinterpret_cast<const Vec *>(src)); }
+MD5_LANES_TARGET inline void store(quint32 *dst, Vec value) { _mm256_store_si256(reinterpret_cast<Vec *>(dst), value); }
+MD5_LANES_TARGET inline Vec add(Vec a, Vec b) { return _mm256_add_epi32(a, b); }
+MD5_LANES_TARGET inline Vec bitXor(Vec a, Vec b) { return _mm256_xor_si256(a, b); }
+MD5_LANES_TARGET inline Vec bitAnd(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+MD5_LANES_TARGET inline Vec bitOr(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+MD5_LANES_TARGET inline Vec bitNot(Vec a) { return _mm256_xor_si256(a, _mm256_set1_epi32(-1)); }
+MD5_LANES_TARGET inline Vec select(Vec mask, Vec a, Vec b) { return _mm256_blendv_epi8(b, a, mask); }
+template<int Shift>
+MD5_LANES_TARGET inline Vec rotl(Vec a) { return _mm256_or_si256(_mm256_slli_epi32(a, Shift), _mm256_srli_epi32(a, 32 - Shift)); }
+
+#include "md5lanes.inc"
+#undef MD5_LANES_TARGET
+
+} // namespace avx2
+
+namespace avx512 {
+
+using Vec = __m512i;
+constexpr int kLanes = 16;
+#define MD5_LANES_TARGET __attribute__((target("avx512f")))
+
+MD5_LANES_TARGET inline Vec set1(quint32 value) { return _mm512_set1_epi32(int(value)); }
+MD5_LANES_TARGET inline Vec load(const quint32 *src) { return _mm512_load_si512(src); }
+MD5_LANES_TARGET inline void store(quint32 *dst, Vec value) { _mm512_store_si512(dst, value); }
+MD5_LANES_TARGET inline Vec add(Vec a, Vec b) { return _mm512_add_epi32(a, b); }
+MD5_LANES_TARGET inline Vec bitXor(Vec a, Vec b) { return _mm512_xor_si512(a, b); }
+MD5_LANES_TARGET inline Vec bitAnd(Vec a, Vec b) { return _mm512_and_si512(a, b); }
+MD5_LANES_TARGET inline Vec bitOr(Vec a, Vec b) { return _mm512_or_si512(a, b); }
+MD5_LANES_TARGET inline Vec bitNot(Vec a) { return _mm512_ternarylogic_epi32(a, a, a, 0x55); }
+MD5_LANES_TARGET inline Vec select(Vec mask, Vec a, Vec b) { return _mm512_ternarylogic_epi32(mask, a, b, 0xca); }
+template<int Shift>
+MD5_LANES_TARGET inline Vec rotl(Vec a) { return _mm512_rol_epi32(a, Shift); }
+
+#include "md5lanes.inc"
+#undef MD5_LANES_TARGET
+
+} // namespace avx512
+#endif // MD5BATCH_X86
+
+struct Md5Backend {
+    const char *name;
+    int lanes;
+    void (*hash)(const QByteArrayView *, Md5Digest *, qsizetype);
+};
+
+// Every backend this CPU can run, widest first; the scalar one is always there.
+const QVector<Md5Backend> &availableBackends()
+{
+    static const QVector<Md5Backend> backends = [] {
+        QVector<Md5Backend> list;
+#ifdef MD5BATCH_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            list.append({"avx512", avx512::kLanes, avx512::hashLanes});
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            list.append({"avx2", avx2::kLanes, avx2::hashLanes});
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            list.append({"sse2", sse2::kLanes, sse2::hashLanes});
+        }
+#endif
+        list.append({"scalar", scalar::kLanes, scalar::hashLanes});
+        return list;
+    }();
+    return backends;
+}
+
+const Md5Backend &selectBackend()
+{
+    return availableBackends().first();
+}
+
+void runBatch(const Md5Backend &backend, const QByteArrayView *messages, Md5Digest *digests, qsizetype count)
+{
+    qsizetype done = 0;
+    // A half-empty vector still beats the scalar loop, so only a lone message falls back.
+    while (count - done > 1) {
+        const qsizetype group = qMin<qsizetype>(backend.lanes, count - done);
+        backend.hash(messages + done, digests + done, group);
+        done += group;
+    }
+    if (done < count) {
+        scalar::hashLanes(messages + done, digests + done, 1);
+    }
+}
+
+} // namespace
+
+Md5Digest md5(QByteArrayView message)
+{
+    Md5Digest digest;
+    scalar::hashLanes(&message, &digest, 1);
+    return digest;
+}
+
+void md5Batch(const QByteArrayView *messages, Md5Digest *digests, qsizetype count)
+{
+    runBatch(selectBackend(), messages, digests, count);
+}
+
+const char *md5BatchBackend()
+{
+    return selectBackend().name;
+}
+
+QList<QByteArray> md5BatchBackends()
+{
+    QList<QByteArray> names;
+    for (const Md5Backend &backend : availableBackends()) {
+        names.append(backend.name);
+    }
+    return names;
+}
+
+bool md5BatchWith(QByteArrayView backend, const QByteArrayView *messages, Md5Digest *digests, qsizetype count)
+{
+    for (const Md5Backend &candidate : availableBackends()) {
+        if (backend == candidate.name) {
+            runBatch(candidate, messages, digests, count);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace crypto
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <QtGlobal>
+
+#include <array>
+
+namespace crypto {
+
+/// Raw 16-byte MD5 digest, as produced by QCryptographicHash::Md5.
+struct Md5Digest {
+    std::array<quint8, 16> bytes{};
+
+    QByteArray toByteArray() const
+    {
+        return QByteArray(reinterpret_cast<const char *>(bytes.data()), int(bytes.size()));
+    }
+
+    friend bool operator==(const Md5Digest &lhs, const Md5Digest &rhs) { return lhs.bytes == rhs.bytes; }
+    friend bool operator!=(const Md5Digest &lhs, const Md5Digest &rhs) { return lhs.bytes != rhs.bytes; }
+};
+
+/// Hashes a single message on the scalar path.
+Md5Digest md5(QByteArrayView message);
+
+/// Hashes @p count independent messages at once, one message per SIMD lane
+/// (16 with AVX-512, 8 with AVX2, 4 with SSE2, scalar otherwise).
+void md5Batch(const QByteArrayView *messages, Md5Digest *digests, qsizetype count);
+
+/// Name of the batch backend picked for this CPU at runtime.
+const char *md5BatchBackend();
+
+/// Every backend this CPU can run, widest first; "scalar" is always last.
+QList<QByteArray> md5BatchBackends();
+/// md5Batch() on the named backend instead of the runtime pick, so tests can check
+/// each lane width. False if @p backend is not available here.
+bool md5BatchWith(QByteArrayView backend, const QByteArrayView *messages, Md5Digest *digests, qsizetype count);
+
+} // namespace crypto
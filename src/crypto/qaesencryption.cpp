@@ -1,10 +1,18 @@
 #include "qaesencryption.h"
 
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <array>
+#include <cstring>
+
 #ifdef USE_INTEL_AES_IF_AVAILABLE
 #include "aesni/aesni-key-exp.h"
 #include "aesni/aesni-key-init.h"
 #include "aesni/aesni-enc-ecb.h"
 #include "aesni/aesni-enc-cbc.h"
+#include "aesni/aesni-enc-cfb.h"
 #endif
 
 /*
@@ -22,6 +30,18 @@ QByteArray QAESEncryption::Decrypt(QAESEncryption::Aes level, QAESEncryption::Mo
      return QAESEncryption(level, mode, padding).decode(rawText, key, iv);
 }
 
+QByteArray QAESEncryption::Crypt(QAESEncryption::Mode mode, const QByteArray &rawText, const QAESKeySchedule &schedule,
+                                 const QByteArray &iv, QAESEncryption::Padding padding)
+{
+    return QAESEncryption(schedule.level(), mode, padding).encode(rawText, schedule, iv);
+}
+
+QByteArray QAESEncryption::Decrypt(QAESEncryption::Mode mode, const QByteArray &rawText, const QAESKeySchedule &schedule,
+                                   const QByteArray &iv, QAESEncryption::Padding padding)
+{
+    return QAESEncryption(schedule.level(), mode, padding).decode(rawText, schedule, iv);
+}
+
 QByteArray QAESEncryption::ExpandKey(QAESEncryption::Aes level, QAESEncryption::Mode mode, const QByteArray &key, bool isEncryptionKey)
 {
      return QAESEncryption(level, mode).expandKey(key, isEncryptionKey);
@@ -82,17 +102,391 @@ QByteArray QAESEncryption::RemovePadding(const QByteArray &rawText, QAESEncrypti
 
 namespace {
 
-quint8 xTime(quint8 x)
+constexpr quint8 kSBox[256] = {
+  //0     1    2      3     4    5     6     7      8    9     A      B    C     D     E     F
+  0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+  0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+  0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+  0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+  0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+  0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+  0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+  0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+  0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+  0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+  0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+  0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+  0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+  0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+  0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+  0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16 };
+
+constexpr quint8 kInvSBox[256] = {
+  0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+  0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+  0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+  0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+  0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+  0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+  0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+  0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+  0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+  0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+  0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+  0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+  0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+  0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+  0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+  0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d };
+
+// The round constant word array, Rcon[i], contains the values given by
+// x to the power (i-1) being powers of x (x is denoted as {02}) in the field GF(2^8).
+// Key expansion never needs more than Rcon[10].
+constexpr quint8 kRcon[11] = {
+  0x8d, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+
+constexpr quint8 xTime(quint8 x)
 {
-    return ((x<<1) ^ (((x>>7) & 1) * 0x1b));
+    return quint8((x<<1) ^ (((x>>7) & 1) * 0x1b));
 }
 
-quint8 multiply(quint8 x, quint8 y)
+constexpr quint8 multiply(quint8 x, quint8 y)
 {
-    return (((y & 1) * x) ^ ((y>>1 & 1) * xTime(x)) ^ ((y>>2 & 1) * xTime(xTime(x))) ^ ((y>>3 & 1)
+    return quint8(((y & 1) * x) ^ ((y>>1 & 1) * xTime(x)) ^ ((y>>2 & 1) * xTime(xTime(x))) ^ ((y>>3 & 1)
             * xTime(xTime(xTime(x)))) ^ ((y>>4 & 1) * xTime(xTime(xTime(xTime(x))))));
 }
 
+using RoundTable = std::array<quint32, 256>;
+
+constexpr quint32 rotateRight8(quint32 word)
+{
+    return (word >> 8) | (word << 24);
+}
+
+// Te tables fuse SubBytes + ShiftRows + MixColumns: each entry is the column
+// {02}·s, s, s, {03}·s for s = S[x], rotated right by one byte per table.
+constexpr RoundTable makeEncryptTable(int rotation)
+{
+    RoundTable table{};
+    for (int i = 0; i < 256; ++i) {
+        const quint8 s = kSBox[i];
+        quint32 word = (quint32(xTime(s)) << 24) | (quint32(s) << 16) | (quint32(s) << 8) | quint32(xTime(s) ^ s);
+        for (int r = 0; r < rotation; ++r)
+            word = rotateRight8(word);
+        table[i] = word;
+    }
+    return table;
+}
+
+// Td tables do the same for InvSubBytes + InvMixColumns with {0e, 09, 0d, 0b}.
+constexpr RoundTable makeDecryptTable(int rotation)
+{
+    RoundTable table{};
+    for (int i = 0; i < 256; ++i) {
+        const quint8 s = kInvSBox[i];
+        quint32 word = (quint32(multiply(s, 0x0e)) << 24) | (quint32(multiply(s, 0x09)) << 16)
+                     | (quint32(multiply(s, 0x0d)) << 8) | quint32(multiply(s, 0x0b));
+        for (int r = 0; r < rotation; ++r)
+            word = rotateRight8(word);
+        table[i] = word;
+    }
+    return table;
+}
+
+constexpr RoundTable kTe0 = makeEncryptTable(0);
+constexpr RoundTable kTe1 = makeEncryptTable(1);
+constexpr RoundTable kTe2 = makeEncryptTable(2);
+constexpr RoundTable kTe3 = makeEncryptTable(3);
+constexpr RoundTable kTd0 = makeDecryptTable(0);
+constexpr RoundTable kTd1 = makeDecryptTable(1);
+constexpr RoundTable kTd2 = makeDecryptTable(2);
+constexpr RoundTable kTd3 = makeDecryptTable(3);
+
+inline quint32 loadBe32(const quint8 *bytes)
+{
+    return (quint32(bytes[0]) << 24) | (quint32(bytes[1]) << 16) | (quint32(bytes[2]) << 8) | quint32(bytes[3]);
+}
+
+inline void storeBe32(quint8 *bytes, quint32 word)
+{
+    bytes[0] = quint8(word >> 24);
+    bytes[1] = quint8(word >> 16);
+    bytes[2] = quint8(word >> 8);
+    bytes[3] = quint8(word);
+}
+
+inline quint32 byteAt(quint32 word, int shift)
+{
+    return (word >> shift) & 0xff;
+}
+
+// Encrypts one 16-byte block. The state is four big-endian column words, so
+// the whole round is 16 table lookups and XORs. in and out may alias.
+void encryptBlock(const quint32 *rk, int rounds, const quint8 *in, quint8 *out)
+{
+    quint32 s0 = loadBe32(in)      ^ rk[0];
+    quint32 s1 = loadBe32(in + 4)  ^ rk[1];
+    quint32 s2 = loadBe32(in + 8)  ^ rk[2];
+    quint32 s3 = loadBe32(in + 12) ^ rk[3];
+
+    for (int round = 1; round < rounds; ++round) {
+        rk += 4;
+        const quint32 t0 = kTe0[s0 >> 24] ^ kTe1[byteAt(s1, 16)] ^ kTe2[byteAt(s2, 8)] ^ kTe3[s3 & 0xff] ^ rk[0];
+        const quint32 t1 = kTe0[s1 >> 24] ^ kTe1[byteAt(s2, 16)] ^ kTe2[byteAt(s3, 8)] ^ kTe3[s0 & 0xff] ^ rk[1];
+        const quint32 t2 = kTe0[s2 >> 24] ^ kTe1[byteAt(s3, 16)] ^ kTe2[byteAt(s0, 8)] ^ kTe3[s1 & 0xff] ^ rk[2];
+        const quint32 t3 = kTe0[s3 >> 24] ^ kTe1[byteAt(s0, 16)] ^ kTe2[byteAt(s1, 8)] ^ kTe3[s2 & 0xff] ^ rk[3];
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    // The last round has no MixColumns, so it goes straight through the S-box.
+    rk += 4;
+    storeBe32(out, ((quint32(kSBox[s0 >> 24]) << 24) | (quint32(kSBox[byteAt(s1, 16)]) << 16)
+                  | (quint32(kSBox[byteAt(s2, 8)]) << 8) | kSBox[s3 & 0xff]) ^ rk[0]);
+    storeBe32(out + 4, ((quint32(kSBox[s1 >> 24]) << 24) | (quint32(kSBox[byteAt(s2, 16)]) << 16)
+                      | (quint32(kSBox[byteAt(s3, 8)]) << 8) | kSBox[s0 & 0xff]) ^ rk[1]);
+    storeBe32(out + 8, ((quint32(kSBox[s2 >> 24]) << 24) | (quint32(kSBox[byteAt(s3, 16)]) << 16)
+                      | (quint32(kSBox[byteAt(s0, 8)]) << 8) | kSBox[s1 & 0xff]) ^ rk[2]);
+    storeBe32(out + 12, ((quint32(kSBox[s3 >> 24]) << 24) | (quint32(kSBox[byteAt(s0, 16)]) << 16)
+                       | (quint32(kSBox[byteAt(s1, 8)]) << 8) | kSBox[s2 & 0xff]) ^ rk[3]);
+}
+
+// Decrypts one block with the equivalent inverse cipher (FIPS-197 5.3.5);
+// dk must come from invertRoundKeys(). in and out may alias.
+void decryptBlock(const quint32 *dk, int rounds, const quint8 *in, quint8 *out)
+{
+    quint32 s0 = loadBe32(in)      ^ dk[0];
+    quint32 s1 = loadBe32(in + 4)  ^ dk[1];
+    quint32 s2 = loadBe32(in + 8)  ^ dk[2];
+    quint32 s3 = loadBe32(in + 12) ^ dk[3];
+
+    for (int round = 1; round < rounds; ++round) {
+        dk += 4;
+        const quint32 t0 = kTd0[s0 >> 24] ^ kTd1[byteAt(s3, 16)] ^ kTd2[byteAt(s2, 8)] ^ kTd3[s1 & 0xff] ^ dk[0];
+        const quint32 t1 = kTd0[s1 >> 24] ^ kTd1[byteAt(s0, 16)] ^ kTd2[byteAt(s3, 8)] ^ kTd3[s2 & 0xff] ^ dk[1];
+        const quint32 t2 = kTd0[s2 >> 24] ^ kTd1[byteAt(s1, 16)] ^ kTd2[byteAt(s0, 8)] ^ kTd3[s3 & 0xff] ^ dk[2];
+        const quint32 t3 = kTd0[s3 >> 24] ^ kTd1[byteAt(s2, 16)] ^ kTd2[byteAt(s1, 8)] ^ kTd3[s0 & 0xff] ^ dk[3];
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    dk += 4;
+    storeBe32(out, ((quint32(kInvSBox[s0 >> 24]) << 24) | (quint32(kInvSBox[byteAt(s3, 16)]) << 16)
+                  | (quint32(kInvSBox[byteAt(s2, 8)]) << 8) | kInvSBox[s1 & 0xff]) ^ dk[0]);
+    storeBe32(out + 4, ((quint32(kInvSBox[s1 >> 24]) << 24) | (quint32(kInvSBox[byteAt(s0, 16)]) << 16)
+                      | (quint32(kInvSBox[byteAt(s3, 8)]) << 8) | kInvSBox[s2 & 0xff]) ^ dk[1]);
+    storeBe32(out + 8, ((quint32(kInvSBox[s2 >> 24]) << 24) | (quint32(kInvSBox[byteAt(s1, 16)]) << 16)
+                      | (quint32(kInvSBox[byteAt(s0, 8)]) << 8) | kInvSBox[s3 & 0xff]) ^ dk[2]);
+    storeBe32(out + 12, ((quint32(kInvSBox[s3 >> 24]) << 24) | (quint32(kInvSBox[byteAt(s2, 16)]) << 16)
+                       | (quint32(kInvSBox[byteAt(s1, 8)]) << 8) | kInvSBox[s0 & 0xff]) ^ dk[3]);
+}
+
+
+// Same rounds as decryptBlock() on several independent states at once; the
+// lane loops unroll into interleaved lookup chains the CPU can overlap.
+template<int Lanes>
+void decryptBlocksInterleaved(const quint32 *dk, int rounds, const quint8 *in, quint8 *out)
+{
+    quint32 s[Lanes][4];
+    quint32 t[Lanes][4];
+    for (int k = 0; k < Lanes; ++k)
+        for (int j = 0; j < 4; ++j)
+            s[k][j] = loadBe32(in + k * 16 + j * 4) ^ dk[j];
+
+    for (int round = 1; round < rounds; ++round) {
+        dk += 4;
+        for (int k = 0; k < Lanes; ++k) {
+            t[k][0] = kTd0[s[k][0] >> 24] ^ kTd1[byteAt(s[k][3], 16)] ^ kTd2[byteAt(s[k][2], 8)] ^ kTd3[s[k][1] & 0xff] ^ dk[0];
+            t[k][1] = kTd0[s[k][1] >> 24] ^ kTd1[byteAt(s[k][0], 16)] ^ kTd2[byteAt(s[k][3], 8)] ^ kTd3[s[k][2] & 0xff] ^ dk[1];
+            t[k][2] = kTd0[s[k][2] >> 24] ^ kTd1[byteAt(s[k][1], 16)] ^ kTd2[byteAt(s[k][0], 8)] ^ kTd3[s[k][3] & 0xff] ^ dk[2];
+            t[k][3] = kTd0[s[k][3] >> 24] ^ kTd1[byteAt(s[k][2], 16)] ^ kTd2[byteAt(s[k][1], 8)] ^ kTd3[s[k][0] & 0xff] ^ dk[3];
+        }
+        std::memcpy(s, t, sizeof(s));
+    }
+
+    dk += 4;
+    for (int k = 0; k < Lanes; ++k) {
+        for (int j = 0; j < 4; ++j) {
+            const quint32 word = (quint32(kInvSBox[s[k][j] >> 24]) << 24)
+                               | (quint32(kInvSBox[byteAt(s[k][(j + 3) & 3], 16)]) << 16)
+                               | (quint32(kInvSBox[byteAt(s[k][(j + 2) & 3], 8)]) << 8)
+                               | kInvSBox[s[k][(j + 1) & 3] & 0xff];
+            storeBe32(out + k * 16 + j * 4, word ^ dk[j]);
+        }
+    }
+}
+
+inline void xorBlock(quint8 *dst, const quint8 *src)
+{
+    for (int i = 0; i < 16; ++i)
+        dst[i] ^= src[i];
+}
+
+inline quint32 subWord(quint32 word)
+{
+    return (quint32(kSBox[word >> 24]) << 24) | (quint32(kSBox[byteAt(word, 16)]) << 16)
+         | (quint32(kSBox[byteAt(word, 8)]) << 8) | kSBox[word & 0xff];
+}
+
+// FIPS-197 key expansion straight into big-endian words.
+void expandEncryptionKey(const quint8 *key, int nk, int rounds, quint32 *w)
+{
+    for (int i = 0; i < nk; ++i)
+        w[i] = loadBe32(key + i * 4);
+
+    for (int i = nk; i < 4 * (rounds + 1); ++i) {
+        quint32 temp = w[i - 1];
+        if (i % nk == 0)
+            temp = subWord((temp << 8) | (temp >> 24)) ^ (quint32(kRcon[i / nk]) << 24);
+        else if (nk > 6 && i % nk == 4)
+            temp = subWord(temp);
+        w[i] = w[i - nk] ^ temp;
+    }
+}
+
+// Builds the equivalent-inverse-cipher schedule used by the Td tables: round
+// keys in reverse order, every inner one passed through InvMixColumns.
+void invertRoundKeys(const quint32 *roundKeys, int rounds, quint32 *invRoundKeys)
+{
+    for (int round = 0; round <= rounds; ++round) {
+        const quint32 *src = roundKeys + (rounds - round) * 4;
+        quint32 *dst = invRoundKeys + round * 4;
+        for (int j = 0; j < 4; ++j) {
+            const quint32 w = src[j];
+            if (round == 0 || round == rounds) {
+                dst[j] = w;
+            } else {
+                dst[j] = kTd0[kSBox[w >> 24]] ^ kTd1[kSBox[byteAt(w, 16)]]
+                       ^ kTd2[kSBox[byteAt(w, 8)]] ^ kTd3[kSBox[w & 0xff]];
+            }
+        }
+    }
+}
+
+constexpr int kInterleavedLanes = 4;
+
+void ecbDecryptBlocks(const quint32 *dk, int rounds, const quint8 *in, quint8 *out, qsizetype length)
+{
+    qsizetype offset = 0;
+    for (; offset + kInterleavedLanes * 16 <= length; offset += kInterleavedLanes * 16)
+        decryptBlocksInterleaved<kInterleavedLanes>(dk, rounds, in + offset, out + offset);
+    for (; offset + 16 <= length; offset += 16)
+        decryptBlock(dk, rounds, in + offset, out + offset);
+}
+
+// CBC decryption of whole blocks; @p feedback is the ciphertext block that
+// precedes @p in (the IV for the first segment). Safe for in == out.
+void cbcDecryptBlocks(const quint32 *dk, int rounds, const quint8 *in, quint8 *out,
+                      qsizetype length, const quint8 *feedback)
+{
+    quint8 chain[16];
+    quint8 plain[kInterleavedLanes * 16];
+    std::memcpy(chain, feedback, 16);
+
+    qsizetype offset = 0;
+    for (; offset + kInterleavedLanes * 16 <= length; offset += kInterleavedLanes * 16) {
+        decryptBlocksInterleaved<kInterleavedLanes>(dk, rounds, in + offset, plain);
+        xorBlock(plain, chain);
+        for (int k = 1; k < kInterleavedLanes; ++k)
+            xorBlock(plain + k * 16, in + offset + (k - 1) * 16);
+        std::memcpy(chain, in + offset + (kInterleavedLanes - 1) * 16, 16);
+        std::memcpy(out + offset, plain, sizeof(plain));
+    }
+    for (; offset + 16 <= length; offset += 16) {
+        decryptBlock(dk, rounds, in + offset, plain);
+        xorBlock(plain, chain);
+        std::memcpy(chain, in + offset, 16);
+        std::memcpy(out + offset, plain, 16);
+    }
+}
+
+void cbcEncryptBlocks(const quint32 *rk, int rounds, const quint8 *in, quint8 *out,
+                      qsizetype length, const quint8 *iv)
+{
+    quint8 chain[16];
+    std::memcpy(chain, iv, 16);
+    for (qsizetype offset = 0; offset + 16 <= length; offset += 16) {
+        xorBlock(chain, in + offset);
+        encryptBlock(rk, rounds, chain, chain);
+        std::memcpy(out + offset, chain, 16);
+    }
+}
+
+void cfbEncryptBlocks(const quint32 *rk, int rounds, const quint8 *in, quint8 *out,
+                      qsizetype length, const quint8 *iv)
+{
+    quint8 feedback[16];
+    std::memcpy(feedback, iv, 16);
+    for (qsizetype offset = 0; offset + 16 <= length; offset += 16) {
+        encryptBlock(rk, rounds, feedback, feedback);
+        xorBlock(feedback, in + offset);
+        std::memcpy(out + offset, feedback, 16);
+    }
+}
+
+void cfbDecryptBlocks(const quint32 *rk, int rounds, const quint8 *in, quint8 *out,
+                      qsizetype length, const quint8 *iv)
+{
+    quint8 feedback[16];
+    quint8 cipherBlock[16];
+    std::memcpy(feedback, iv, 16);
+    for (qsizetype offset = 0; offset + 16 <= length; offset += 16) {
+        std::memcpy(cipherBlock, in + offset, 16);
+        encryptBlock(rk, rounds, feedback, feedback);
+        xorBlock(feedback, cipherBlock);
+        std::memcpy(out + offset, feedback, 16);
+        std::memcpy(feedback, cipherBlock, 16);
+    }
+}
+
+// OFB is symmetric, the same keystream XOR encrypts and decrypts.
+void ofbCryptBlocks(const quint32 *rk, int rounds, const quint8 *in, quint8 *out,
+                    qsizetype length, const quint8 *iv)
+{
+    quint8 keystream[16];
+    std::memcpy(keystream, iv, 16);
+    for (qsizetype offset = 0; offset + 16 <= length; offset += 16) {
+        encryptBlock(rk, rounds, keystream, keystream);
+        for (int i = 0; i < 16; ++i)
+            out[offset + i] = in[offset + i] ^ keystream[i];
+    }
+}
+
+// Inputs below this size are decrypted on the calling thread.
+constexpr qsizetype kParallelCbcThreshold = 1 << 20;
+constexpr qsizetype kMinCbcSegment = 256 * 1024;
+
+struct CbcSegment {
+    qsizetype offset = 0;
+    qsizetype length = 0;
+    // Copied up front: with in == out the previous segment may already be
+    // overwriting this block by the time the worker starts.
+    quint8 feedback[16] = {};
+};
+
+// CBC decryption of block i only needs ciphertext blocks i and i-1, so large
+// inputs are cut into block-aligned segments and decrypted on the thread pool.
+template<typename SegmentFn>
+void forEachCbcSegment(const quint8 *in, qsizetype length, const quint8 *iv, SegmentFn decryptSegment)
+{
+    const int workers = QThread::idealThreadCount();
+    if (length < kParallelCbcThreshold || workers < 2) {
+        decryptSegment(qsizetype(0), length, iv);
+        return;
+    }
+
+    const qsizetype segmentSize = qMax(kMinCbcSegment, ((length / workers) + 15) & ~qsizetype(15));
+    QVector<CbcSegment> segments;
+    for (qsizetype offset = 0; offset < length; offset += segmentSize) {
+        CbcSegment segment;
+        segment.offset = offset;
+        segment.length = qMin(segmentSize, length - offset);
+        std::memcpy(segment.feedback, offset ? in + offset - 16 : iv, 16);
+        segments.push_back(segment);
+    }
+
+    QtConcurrent::blockingMap(segments, [&decryptSegment](const CbcSegment &segment) {
+        decryptSegment(segment.offset, segment.length, segment.feedback);
+    });
+}
 }
 
 /*
@@ -102,7 +496,7 @@ quint8 multiply(quint8 x, quint8 y)
 QAESEncryption::QAESEncryption(Aes level, Mode mode,
                                Padding padding)
     : m_nb(4), m_blocklen(16), m_level(level), m_mode(mode), m_padding(padding)
-    , m_aesNIAvailable(false), m_state(nullptr)
+    , m_aesNIAvailable(false)
 {
 #ifdef USE_INTEL_AES_IF_AVAILABLE
     m_aesNIAvailable = check_aesni_support();
@@ -145,7 +539,7 @@ QAESEncryption::QAESEncryption(Aes level, Mode mode,
     }
 
 }
-QByteArray QAESEncryption::getPadding(int currSize, int alignment)
+QByteArray QAESEncryption::getPadding(int currSize, int alignment) const
 {
     int size = (alignment - currSize % alignment) % alignment;
     switch(m_padding)
@@ -230,459 +624,217 @@ QByteArray QAESEncryption::expandKey(const QByteArray &key, bool isEncryptionKey
       } else
 #endif
   {
-
-      int i, k;
-      quint8 tempa[4]; // Used for the column/row operations
-      QByteArray roundKey(key); // The first round key is the key itself.
-
-      // All other round keys are found from the previous round keys.
-      //i == Nk
-      for(i = m_nk; i < m_nb * (m_nr + 1); i++)
-      {
-        tempa[0] = (quint8) roundKey.at((i-1) * 4 + 0);
-        tempa[1] = (quint8) roundKey.at((i-1) * 4 + 1);
-        tempa[2] = (quint8) roundKey.at((i-1) * 4 + 2);
-        tempa[3] = (quint8) roundKey.at((i-1) * 4 + 3);
-
-        if (i % m_nk == 0)
-        {
-            // This function shifts the 4 bytes in a word to the left once.
-            // [a0,a1,a2,a3] becomes [a1,a2,a3,a0]
-
-            // Function RotWord()
-            k = tempa[0];
-            tempa[0] = tempa[1];
-            tempa[1] = tempa[2];
-            tempa[2] = tempa[3];
-            tempa[3] = k;
-
-            // Function Subword()
-            tempa[0] = getSBoxValue(tempa[0]);
-            tempa[1] = getSBoxValue(tempa[1]);
-            tempa[2] = getSBoxValue(tempa[2]);
-            tempa[3] = getSBoxValue(tempa[3]);
-
-            tempa[0] =  tempa[0] ^ Rcon[i/m_nk];
-        }
-
-        if (m_level == AES_256 && i % m_nk == 4)
-        {
-            // Function Subword()
-            tempa[0] = getSBoxValue(tempa[0]);
-            tempa[1] = getSBoxValue(tempa[1]);
-            tempa[2] = getSBoxValue(tempa[2]);
-            tempa[3] = getSBoxValue(tempa[3]);
-        }
-        roundKey.insert(i * 4 + 0, (quint8) roundKey.at((i - m_nk) * 4 + 0) ^ tempa[0]);
-        roundKey.insert(i * 4 + 1, (quint8) roundKey.at((i - m_nk) * 4 + 1) ^ tempa[1]);
-        roundKey.insert(i * 4 + 2, (quint8) roundKey.at((i - m_nk) * 4 + 2) ^ tempa[2]);
-        roundKey.insert(i * 4 + 3, (quint8) roundKey.at((i - m_nk) * 4 + 3) ^ tempa[3]);
-      }
-      return roundKey;
+      // Without AES-NI both directions share the FIPS-197 schedule.
+      Q_UNUSED(isEncryptionKey);
+      const QAESKeySchedule schedule(static_cast<Aes>(m_level), key);
+      if (!schedule.isValid())
+          return QByteArray();
+      return QByteArray(schedule.encryptionKeyBytes(), m_nb * (m_nr + 1) * 4);
   }
 }
 
-// This function adds the round key to state.
-// The round key is added to the state by an XOR function.
-void QAESEncryption::addRoundKey(const quint8 round, const QByteArray &expKey)
-{
-  QByteArray::iterator it = m_state->begin();
-  for(int i=0; i < 16; ++i)
-      it[i] = (quint8) it[i] ^ (quint8) expKey.at(round * m_nb * 4 + (i/4) * m_nb + (i%4));
-}
-
-// The SubBytes Function Substitutes the values in the
-// state matrix with values in an S-box.
-void QAESEncryption::subBytes()
+void QAESEncryption::setHardwareAcceleration(bool enabled)
 {
-  QByteArray::iterator it = m_state->begin();
-  for(int i = 0; i < 16; i++)
-    it[i] = getSBoxValue((quint8) it[i]);
+#ifdef USE_INTEL_AES_IF_AVAILABLE
+    m_aesNIAvailable = enabled && check_aesni_support();
+#else
+    Q_UNUSED(enabled);
+#endif
 }
 
-// The ShiftRows() function shifts the rows in the state to the left.
-// Each row is shifted with different offset.
-// Offset = Row number. So the first row is not shifted.
-void QAESEncryption::shiftRows()
+QByteArray QAESEncryption::printArray(uchar* arr, int size)
 {
-    QByteArray::iterator it = m_state->begin();
-    quint8 temp;
-    //Keep in mind that QByteArray is column-driven!!
-
-     //Shift 1 to left
-    temp   = (quint8)it[1];
-    it[1]  = (quint8)it[5];
-    it[5]  = (quint8)it[9];
-    it[9]  = (quint8)it[13];
-    it[13] = (quint8)temp;
-
-    //Shift 2 to left
-    temp   = (quint8)it[2];
-    it[2]  = (quint8)it[10];
-    it[10] = (quint8)temp;
-    temp   = (quint8)it[6];
-    it[6]  = (quint8)it[14];
-    it[14] = (quint8)temp;
+    QByteArray print("");
+    for(int i=0; i<size; i++)
+        print.append(arr[i]);
 
-    //Shift 3 to left
-    temp   = (quint8)it[3];
-    it[3]  = (quint8)it[15];
-    it[15] = (quint8)it[11];
-    it[11] = (quint8)it[7];
-    it[7]  = (quint8)temp;
+    return print.toHex();
 }
 
-// MixColumns function mixes the columns of the state matrix
-//optimized!!
-void QAESEncryption::mixColumns()
+bool QAESEncryption::encrypt(const QAESKeySchedule &schedule, const quint8 *in, quint8 *out,
+                             qsizetype length, const quint8 *iv) const
 {
-  QByteArray::iterator it = m_state->begin();
-  quint8 tmp, tm, t;
+    if (!schedule.isValid() || schedule.level() != m_level || length % m_blocklen != 0 || (m_mode >= CBC && !iv))
+        return false;
 
-  for(int i = 0; i < 16; i += 4){
-    t       = (quint8)it[i];
-    tmp     =  (quint8)it[i] ^ (quint8)it[i+1] ^ (quint8)it[i+2] ^ (quint8)it[i+3] ;
-
-    tm      = xTime( (quint8)it[i] ^ (quint8)it[i+1] );
-    it[i]   = (quint8)it[i] ^ (quint8)tm ^ (quint8)tmp;
-
-    tm      = xTime( (quint8)it[i+1] ^ (quint8)it[i+2]);
-    it[i+1] = (quint8)it[i+1] ^ (quint8)tm ^ (quint8)tmp;
-
-    tm      = xTime( (quint8)it[i+2] ^ (quint8)it[i+3]);
-    it[i+2] =(quint8)it[i+2] ^ (quint8)tm ^ (quint8)tmp;
+#ifdef USE_INTEL_AES_IF_AVAILABLE
+    if (m_aesNIAvailable){
+        // Encryption only ever runs the forward cipher, so one schedule serves every mode.
+        const char *expKey = schedule.encryptionKeyBytes();
+        switch(m_mode)
+        {
+        case ECB: AES_ECB_encrypt(in, out, length, expKey, m_nr); return true;
+        case CBC: AES_CBC_encrypt(in, out, iv, length, expKey, m_nr); return true;
+        case CFB: AES_CFB_encrypt(in, out, iv, length, expKey, m_nr); return true;
+        case OFB: AES_OFB_crypt(in, out, iv, length, expKey, m_nr); return true;
+        default: return false;
+        }
+    }
+#endif
 
-    tm      = xTime((quint8)it[i+3] ^ (quint8)t);
-    it[i+3] =(quint8)it[i+3] ^ (quint8)tm ^ (quint8)tmp;
-  }
+    const quint32 *roundKeys = schedule.encryptionWords();
+    switch(m_mode)
+    {
+    case ECB:
+        for (qsizetype offset = 0; offset < length; offset += m_blocklen)
+            encryptBlock(roundKeys, m_nr, in + offset, out + offset);
+        return true;
+    case CBC:
+        cbcEncryptBlocks(roundKeys, m_nr, in, out, length, iv);
+        return true;
+    case CFB:
+        cfbEncryptBlocks(roundKeys, m_nr, in, out, length, iv);
+        return true;
+    case OFB:
+        ofbCryptBlocks(roundKeys, m_nr, in, out, length, iv);
+        return true;
+    default:
+        return false;
+    }
 }
 
-// MixColumns function mixes the columns of the state matrix.
-// The method used to multiply may be difficult to understand for the inexperienced.
-// Please use the references to gain more information.
-void QAESEncryption::invMixColumns()
+bool QAESEncryption::decrypt(const QAESKeySchedule &schedule, const quint8 *in, quint8 *out,
+                             qsizetype length, const quint8 *iv) const
 {
-  QByteArray::iterator it = m_state->begin();
-  quint8 a,b,c,d;
-  for(int i = 0; i < 16; i+=4){
-    a = (quint8) it[i];
-    b = (quint8) it[i+1];
-    c = (quint8) it[i+2];
-    d = (quint8) it[i+3];
+    if (!schedule.isValid() || schedule.level() != m_level || length % m_blocklen != 0 || (m_mode >= CBC && !iv))
+        return false;
 
-    it[i]   = (quint8) (multiply(a, 0x0e) ^ multiply(b, 0x0b) ^ multiply(c, 0x0d) ^ multiply(d, 0x09));
-    it[i+1] = (quint8) (multiply(a, 0x09) ^ multiply(b, 0x0e) ^ multiply(c, 0x0b) ^ multiply(d, 0x0d));
-    it[i+2] = (quint8) (multiply(a, 0x0d) ^ multiply(b, 0x09) ^ multiply(c, 0x0e) ^ multiply(d, 0x0b));
-    it[i+3] = (quint8) (multiply(a, 0x0b) ^ multiply(b, 0x0d) ^ multiply(c, 0x09) ^ multiply(d, 0x0e));
-  }
-}
+#ifdef USE_INTEL_AES_IF_AVAILABLE
+    if (m_aesNIAvailable){
+        //the expandedKeys aren't the same for aes-ni ENcryption and DEcryption (only CBC and ECB),
+        //CFB and OFB run the forward cipher in both directions
+        switch(m_mode)
+        {
+        case ECB:
+            AES_ECB_decrypt(in, out, length, schedule.decryptionKeyBytes(), m_nr);
+            return true;
+        case CBC:
+            forEachCbcSegment(in, length, iv, [&](qsizetype offset, qsizetype segmentLength, const quint8 *feedback) {
+                AES_CBC_decrypt(in + offset, out + offset, feedback, segmentLength,
+                                schedule.decryptionKeyBytes(), m_nr);
+            });
+            return true;
+        case CFB:
+            AES_CFB_decrypt(in, out, iv, length, schedule.encryptionKeyBytes(), m_nr);
+            return true;
+        case OFB:
+            AES_OFB_crypt(in, out, iv, length, schedule.encryptionKeyBytes(), m_nr);
+            return true;
+        default:
+            return false;
+        }
+    }
+#endif
 
-// The SubBytes Function Substitutes the values in the
-// state matrix with values in an S-box.
-void QAESEncryption::invSubBytes()
-{
-    QByteArray::iterator it = m_state->begin();
-    for(int i = 0; i < 16; ++i)
-        it[i] = getSBoxInvert((quint8) it[i]);
+    switch(m_mode)
+    {
+    case ECB:
+        ecbDecryptBlocks(schedule.decryptionWords(), m_nr, in, out, length);
+        return true;
+    case CBC:
+        forEachCbcSegment(in, length, iv, [&](qsizetype offset, qsizetype segmentLength, const quint8 *feedback) {
+            cbcDecryptBlocks(schedule.decryptionWords(), m_nr, in + offset, out + offset, segmentLength, feedback);
+        });
+        return true;
+    case CFB:
+        cfbDecryptBlocks(schedule.encryptionWords(), m_nr, in, out, length, iv);
+        return true;
+    case OFB:
+        ofbCryptBlocks(schedule.encryptionWords(), m_nr, in, out, length, iv);
+        return true;
+    default:
+        return false;
+    }
 }
 
-void QAESEncryption::invShiftRows()
+QByteArray QAESEncryption::encode(const QByteArray &rawText, const QByteArray &key, const QByteArray &iv)
 {
-    QByteArray::iterator it = m_state->begin();
-    uint8_t temp;
-
-    //Keep in mind that QByteArray is column-driven!!
-
-    //Shift 1 to right
-    temp   = (quint8)it[13];
-    it[13] = (quint8)it[9];
-    it[9]  = (quint8)it[5];
-    it[5]  = (quint8)it[1];
-    it[1]  = (quint8)temp;
-
-    //Shift 2
-    temp   = (quint8)it[10];
-    it[10] = (quint8)it[2];
-    it[2]  = (quint8)temp;
-    temp   = (quint8)it[14];
-    it[14] = (quint8)it[6];
-    it[6]  = (quint8)temp;
+    if (key.size() != m_keyLen)
+           return QByteArray();
 
-    //Shift 3
-    temp   = (quint8)it[7];
-    it[7]  = (quint8)it[11];
-    it[11] = (quint8)it[15];
-    it[15] = (quint8)it[3];
-    it[3]  = (quint8)temp;
+    return encode(rawText, QAESKeySchedule(static_cast<Aes>(m_level), key), iv);
 }
 
-QByteArray QAESEncryption::byteXor(const QByteArray &a, const QByteArray &b)
+QByteArray QAESEncryption::decode(const QByteArray &rawText, const QByteArray &key, const QByteArray &iv)
 {
-  QByteArray::const_iterator it_a = a.begin();
-  QByteArray::const_iterator it_b = b.begin();
-  QByteArray ret;
-
-  //for(int i = 0; i < m_blocklen; i++)
-  for(int i = 0; i < std::min(a.size(), b.size()); i++)
-      ret.insert(i,it_a[i] ^ it_b[i]);
+    if (key.size() != m_keyLen)
+           return QByteArray();
 
-  return ret;
+    return decode(rawText, QAESKeySchedule(static_cast<Aes>(m_level), key), iv);
 }
 
-// Cipher is the main function that encrypts the PlainText.
-QByteArray QAESEncryption::cipher(const QByteArray &expKey, const QByteArray &in)
+QByteArray QAESEncryption::encode(const QByteArray &rawText, const QAESKeySchedule &schedule, const QByteArray &iv) const
 {
+    if ((m_mode >= CBC && (iv.isEmpty() || iv.size() != m_blocklen)) || schedule.level() != m_level)
+           return QByteArray();
 
-  //m_state is the input buffer...
-  QByteArray output(in);
-  m_state = &output;
-
-  // Add the First round key to the state before starting the rounds.
-  addRoundKey(0, expKey);
+    QByteArray alignedText(rawText);
 
-  // There will be Nr rounds.
-  // The first Nr-1 rounds are identical.
-  // These Nr-1 rounds are executed in the loop below.
-  for(quint8 round = 1; round < m_nr; ++round){
-    subBytes();
-    shiftRows();
-    mixColumns();
-    addRoundKey(round, expKey);
-  }
+    //Fill array with padding
+    alignedText.append(getPadding(rawText.size(), m_blocklen));
 
-  // The last round is given below.
-  // The MixColumns function is not here in the last round.
-  subBytes();
-  shiftRows();
-  addRoundKey(m_nr, expKey);
-
-  return output;
+    auto *data = reinterpret_cast<quint8 *>(alignedText.data());
+    if (!encryptInPlace(schedule, data, alignedText.size(), reinterpret_cast<const quint8 *>(iv.constData())))
+        return QByteArray();
+    return alignedText;
 }
 
-QByteArray QAESEncryption::invCipher(const QByteArray &expKey, const QByteArray &in)
+QByteArray QAESEncryption::decode(const QByteArray &rawText, const QAESKeySchedule &schedule, const QByteArray &iv) const
 {
-    //m_state is the input buffer.... handle it!
-    QByteArray output(in);
-    m_state = &output;
-
-    // Add the First round key to the state before starting the rounds.
-    addRoundKey(m_nr, expKey);
-
-    // There will be Nr rounds.
-    // The first Nr-1 rounds are identical.
-    // These Nr-1 rounds are executed in the loop below.
-    for(quint8 round=m_nr-1; round>0 ; round--){
-        invShiftRows();
-        invSubBytes();
-        addRoundKey(round, expKey);
-        invMixColumns();
-    }
-
-    // The last round is given below.
-    // The MixColumns function is not here in the last round.
-    invShiftRows();
-    invSubBytes();
-    addRoundKey(0, expKey);
+    if ((m_mode >= CBC && (iv.isEmpty() || iv.size() != m_blocklen)) || schedule.level() != m_level
+        || rawText.size() % m_blocklen != 0)
+           return QByteArray();
 
-    return output;
+    QByteArray ret(rawText.size(), Qt::Uninitialized);
+    if (!decrypt(schedule,
+                 reinterpret_cast<const quint8 *>(rawText.constData()),
+                 reinterpret_cast<quint8 *>(ret.data()),
+                 rawText.size(),
+                 reinterpret_cast<const quint8 *>(iv.constData())))
+        return QByteArray();
+    return ret;
 }
 
-QByteArray QAESEncryption::printArray(uchar* arr, int size)
+QByteArray QAESEncryption::removePadding(const QByteArray &rawText)
 {
-    QByteArray print("");
-    for(int i=0; i<size; i++)
-        print.append(arr[i]);
-
-    return print.toHex();
+    return RemovePadding(rawText, (Padding) m_padding);
 }
 
-QByteArray QAESEncryption::encode(const QByteArray &rawText, const QByteArray &key, const QByteArray &iv)
-{
-    if ((m_mode >= CBC && (iv.isEmpty() || iv.size() != m_blocklen)) || key.size() != m_keyLen)
-           return QByteArray();
-
-        QByteArray expandedKey = expandKey(key, true);
-        QByteArray alignedText(rawText);
-
-        //Fill array with padding
-        alignedText.append(getPadding(rawText.size(), m_blocklen));
-
-    switch(m_mode)
-    {
-    case ECB: {
-#ifdef USE_INTEL_AES_IF_AVAILABLE
-        if (m_aesNIAvailable){
-            char expKey[expandedKey.size()];
-            memcpy(expKey, expandedKey.data(), expandedKey.size());
-
-            QByteArray outText;
-            outText.resize(alignedText.size());
-            AES_ECB_encrypt((unsigned char*) alignedText.constData(),
-                            (unsigned char*) outText.data(),
-                            alignedText.size(),
-                            expKey,
-                            m_nr);
-            return outText;
-        }
-#endif
-        QByteArray ret;
-        for(int i=0; i < alignedText.size(); i+= m_blocklen)
-            ret.append(cipher(expandedKey, alignedText.mid(i, m_blocklen)));
-        return ret;
-    }
-    break;
-    case CBC: {
-#ifdef USE_INTEL_AES_IF_AVAILABLE
-        if (m_aesNIAvailable){
-            quint8 ivec[iv.size()];
-            memcpy(ivec, iv.data(), iv.size());
-            char expKey[expandedKey.size()];
-            memcpy(expKey, expandedKey.data(), expandedKey.size());
-
-            QByteArray outText;
-            outText.resize(alignedText.size());
-            AES_CBC_encrypt((unsigned char*) alignedText.constData(),
-                            (unsigned char*) outText.data(),
-                            ivec,
-                            alignedText.size(),
-                            expKey,
-                            m_nr);
-            return outText;
-        }
-#endif
-        QByteArray ret;
-        QByteArray ivTemp(iv);
-        for(int i=0; i < alignedText.size(); i+= m_blocklen) {
-            alignedText.replace(i, m_blocklen, byteXor(alignedText.mid(i, m_blocklen),ivTemp));
-            ret.append(cipher(expandedKey, alignedText.mid(i, m_blocklen)));
-            ivTemp = ret.mid(i, m_blocklen);
-        }
-        return ret;
-    }
-    break;
-    case CFB: {
-        QByteArray ret;
-        ret.append(byteXor(alignedText.left(m_blocklen), cipher(expandedKey, iv)));
-        for(int i=0; i < alignedText.size(); i+= m_blocklen) {
-            if (i+m_blocklen < alignedText.size())
-                ret.append(byteXor(alignedText.mid(i+m_blocklen, m_blocklen),
-                                   cipher(expandedKey, ret.mid(i, m_blocklen))));
-        }
-        return ret;
-    }
-    break;
-    case OFB: {
-    QByteArray ret;
-        QByteArray ofbTemp;
-        ofbTemp.append(cipher(expandedKey, iv));
-        for (int i=m_blocklen; i < alignedText.size(); i += m_blocklen){
-            ofbTemp.append(cipher(expandedKey, ofbTemp.right(m_blocklen)));
-        }
-        ret.append(byteXor(alignedText, ofbTemp));
-        return ret;
-    }
-    break;
-    default: break;
-    }
-    return QByteArray();
-}
+/*
+ * QAESKeySchedule
+ * */
 
-QByteArray QAESEncryption::decode(const QByteArray &rawText, const QByteArray &key, const QByteArray &iv)
+QAESKeySchedule::QAESKeySchedule(QAESEncryption::Aes level, const QByteArray &key)
 {
-    if ((m_mode >= CBC && (iv.isEmpty() || iv.size() != m_blocklen)) || key.size() != m_keyLen || rawText.size() % m_blocklen != 0)
-           return QByteArray();
-
-        QByteArray ret;
-        QByteArray expandedKey;
-
-    #ifdef USE_INTEL_AES_IF_AVAILABLE
-        if(m_aesNIAvailable && m_mode <= CBC){
-            expandedKey = expandKey(key, false);
-        }else{
-            expandedKey = expandKey(key, true);
-        }
-    #else
-        expandedKey = expandKey(key, true);
-    #endif
-        //false or true here is very important
-        //the expandedKeys aren't the same for !aes-ni! ENcryption and DEcryption (only CBC and EBC)
-        //but if you are !NOT! using aes-ni then the expandedKeys for encryption and decryption are the SAME!!!
-
-
-    switch(m_mode)
+    int nk = 0;
+    int rounds = 0;
+    switch (level)
     {
-    case ECB:
-#ifdef USE_INTEL_AES_IF_AVAILABLE
-        if (m_aesNIAvailable){
-            char expKey[expandedKey.size()];                                //expandedKey
-            memcpy(expKey, expandedKey.data(), expandedKey.size());
-            ret.resize(rawText.size());
-
-            AES_ECB_decrypt((unsigned char*) rawText.constData(),
-                            (unsigned char*) ret.data(),
-                            rawText.size(),
-                            expKey,
-                            m_nr);
-            break;
-        }
-#endif
-        for(int i=0; i < rawText.size(); i+= m_blocklen)
-            ret.append(invCipher(expandedKey, rawText.mid(i, m_blocklen)));
-        break;
-    case CBC:
-#ifdef USE_INTEL_AES_IF_AVAILABLE
-        if (m_aesNIAvailable){
-            quint8 ivec[iv.size()];                                         //IV
-            memcpy(ivec, iv.constData(), iv.size());
-            char expKey[expandedKey.size()];                                //expandedKey
-            memcpy(expKey, expandedKey.data(), expandedKey.size());
-            ret.resize(rawText.size());
-
-            AES_CBC_decrypt((unsigned char*) rawText.constData(),
-                            (unsigned char*) ret.data(),
-                            ivec,
-                            rawText.size(),
-                            expKey,
-                            m_nr);
-            break;
-        }
-#endif
-        {
-            QByteArray ivTemp(iv);
-            for(int i=0; i < rawText.size(); i+= m_blocklen){
-                ret.append(invCipher(expandedKey, rawText.mid(i, m_blocklen)));
-                ret.replace(i, m_blocklen, byteXor(ret.mid(i, m_blocklen),ivTemp));
-                ivTemp = rawText.mid(i, m_blocklen);
-            }
-        }
-        break;
-    case CFB: {
-            ret.append(byteXor(rawText.mid(0, m_blocklen), cipher(expandedKey, iv)));
-            for(int i=0; i < rawText.size(); i+= m_blocklen){
-                if (i+m_blocklen < rawText.size()) {
-                    ret.append(byteXor(rawText.mid(i+m_blocklen, m_blocklen),
-                                       cipher(expandedKey, rawText.mid(i, m_blocklen))));
-                }
-            }
-        }
-        break;
-    case OFB: {
-        QByteArray ofbTemp;
-        ofbTemp.append(cipher(expandedKey, iv));
-        for (int i=m_blocklen; i < rawText.size(); i += m_blocklen){
-            ofbTemp.append(cipher(expandedKey, ofbTemp.right(m_blocklen)));
-        }
-        ret.append(byteXor(rawText, ofbTemp));
+    case QAESEncryption::AES_128: nk = 4; rounds = 10; break;
+    case QAESEncryption::AES_192: nk = 6; rounds = 12; break;
+    case QAESEncryption::AES_256: nk = 8; rounds = 14; break;
+    default: return;
     }
-        break;
-    default:
-        //do nothing
-        break;
+    if (key.size() != nk * 4)
+        return;
+
+    expandEncryptionKey(reinterpret_cast<const quint8 *>(key.constData()), nk, rounds, m_encryptionWords);
+    invertRoundKeys(m_encryptionWords, rounds, m_decryptionWords);
+    // The AES-NI layout is the same schedule serialised byte by byte;
+    // AESIMC and the Td-based InvMixColumns agree on the decryption keys.
+    for (int i = 0; i < 4 * (rounds + 1); ++i) {
+        storeBe32(reinterpret_cast<quint8 *>(m_encryptionBytes) + i * 4, m_encryptionWords[i]);
+        storeBe32(reinterpret_cast<quint8 *>(m_decryptionBytes) + i * 4, m_decryptionWords[i]);
     }
-    return ret;
+
+    m_level = level;
+    m_rounds = rounds;
 }
 
-QByteArray QAESEncryption::removePadding(const QByteArray &rawText)
+QAESKeySchedule::~QAESKeySchedule()
 {
-    return RemovePadding(rawText, (Padding) m_padding);
+    std::memset(m_encryptionWords, 0, sizeof(m_encryptionWords));
+    std::memset(m_decryptionWords, 0, sizeof(m_decryptionWords));
+    std::memset(m_encryptionBytes, 0, sizeof(m_encryptionBytes));
+    std::memset(m_decryptionBytes, 0, sizeof(m_decryptionBytes));
 }
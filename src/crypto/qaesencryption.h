@@ -0,0 +1,155 @@
+#ifndef QAESENCRYPTION_H
+#define QAESENCRYPTION_H
+
+#include <QByteArray>
+#include <QObject>
+
+class QAESKeySchedule;
+
+/// AES-128/192/256 in ECB, CBC, CFB and OFB modes on top of a 32-bit T-table core.
+class QAESEncryption : public QObject
+{
+    Q_OBJECT
+public:
+    enum Aes {
+        AES_128,
+        AES_192,
+        AES_256
+    };
+
+    enum Mode {
+        ECB,
+        CBC,
+        CFB,
+        OFB
+    };
+
+    enum Padding {
+      ZERO,
+      PKCS7,
+      ISO
+    };
+
+    static QByteArray Crypt(QAESEncryption::Aes level, QAESEncryption::Mode mode, const QByteArray &rawText, const QByteArray &key,
+                            const QByteArray &iv = QByteArray(), QAESEncryption::Padding padding = QAESEncryption::ISO);
+    static QByteArray Decrypt(QAESEncryption::Aes level, QAESEncryption::Mode mode, const QByteArray &rawText, const QByteArray &key,
+                              const QByteArray &iv = QByteArray(), QAESEncryption::Padding padding = QAESEncryption::ISO);
+    /// Overloads that reuse an already expanded key; the level is taken from @p schedule.
+    static QByteArray Crypt(QAESEncryption::Mode mode, const QByteArray &rawText, const QAESKeySchedule &schedule,
+                            const QByteArray &iv = QByteArray(), QAESEncryption::Padding padding = QAESEncryption::ISO);
+    static QByteArray Decrypt(QAESEncryption::Mode mode, const QByteArray &rawText, const QAESKeySchedule &schedule,
+                              const QByteArray &iv = QByteArray(), QAESEncryption::Padding padding = QAESEncryption::ISO);
+    static QByteArray ExpandKey(QAESEncryption::Aes level, QAESEncryption::Mode mode, const QByteArray &key, bool isEncryptionKey);
+    static QByteArray RemovePadding(const QByteArray &rawText, QAESEncryption::Padding padding = QAESEncryption::ISO);
+
+    QAESEncryption(QAESEncryption::Aes level, QAESEncryption::Mode mode,
+                   QAESEncryption::Padding padding = QAESEncryption::ISO);
+
+    QByteArray encode(const QByteArray &rawText, const QByteArray &key, const QByteArray &iv = QByteArray());
+    QByteArray decode(const QByteArray &rawText, const QByteArray &key, const QByteArray &iv = QByteArray());
+    /// Same as above without re-expanding the key. Const and allocation-light, so one
+    /// QAESEncryption and one schedule may serve several threads at once.
+    QByteArray encode(const QByteArray &rawText, const QAESKeySchedule &schedule, const QByteArray &iv = QByteArray()) const;
+    QByteArray decode(const QByteArray &rawText, const QAESKeySchedule &schedule, const QByteArray &iv = QByteArray()) const;
+    QByteArray removePadding(const QByteArray &rawText);
+    QByteArray expandKey(const QByteArray &key, bool isEncryptionKey);
+
+    /// Encrypts @p length bytes (a multiple of 16, already padded) from @p in to @p out without
+    /// allocating; @p in and @p out may be the same buffer. @p iv is ignored in ECB mode.
+    bool encrypt(const QAESKeySchedule &schedule, const quint8 *in, quint8 *out, qsizetype length,
+                 const quint8 *iv = nullptr) const;
+    /// Decrypts @p length bytes (a multiple of 16) from @p in to @p out; padding is left in place.
+    bool decrypt(const QAESKeySchedule &schedule, const quint8 *in, quint8 *out, qsizetype length,
+                 const quint8 *iv = nullptr) const;
+    bool encryptInPlace(const QAESKeySchedule &schedule, quint8 *data, qsizetype length, const quint8 *iv = nullptr) const
+    {
+        return encrypt(schedule, data, data, length, iv);
+    }
+    bool decryptInPlace(const QAESKeySchedule &schedule, quint8 *data, qsizetype length, const quint8 *iv = nullptr) const
+    {
+        return decrypt(schedule, data, data, length, iv);
+    }
+
+    QByteArray printArray(uchar *arr, int size);
+
+    /// Whether this instance runs on AES-NI/VAES. On by default when the CPU has it;
+    /// switching it off forces the T-table path, e.g. to compare both in tests.
+    bool hardwareAcceleration() const { return m_aesNIAvailable; }
+    /// Enabling has no effect without USE_INTEL_AES_IF_AVAILABLE or CPU support.
+    void setHardwareAcceleration(bool enabled);
+
+private:
+    int m_nb;
+    int m_blocklen;
+    int m_level;
+    int m_mode;
+    int m_nk;
+    int m_keyLen;
+    int m_nr;
+    int m_expandedKey;
+    int m_padding;
+    bool m_aesNIAvailable;
+
+    struct AES256{
+        int nk = 8;
+        int keylen = 32;
+        int nr = 14;
+        int expandedKey = 240;
+        int userKeySize = 256;
+    };
+
+    struct AES192{
+        int nk = 6;
+        int keylen = 24;
+        int nr = 12;
+        int expandedKey = 208;
+        int userKeySize = 192;
+    };
+
+    struct AES128{
+        int nk = 4;
+        int keylen = 16;
+        int nr = 10;
+        int expandedKey = 176;
+        int userKeySize = 128;
+    };
+
+    QByteArray getPadding(int currSize, int alignment) const;
+};
+
+/// Encryption and decryption round keys for one AES key, expanded once up front.
+/// Immutable after construction, so a single instance may be shared by several threads.
+class QAESKeySchedule
+{
+public:
+    QAESKeySchedule(QAESEncryption::Aes level, const QByteArray &key);
+    ~QAESKeySchedule();
+
+    QAESKeySchedule(const QAESKeySchedule &) = default;
+    QAESKeySchedule &operator=(const QAESKeySchedule &) = default;
+
+    /// False when the key length does not match @p level.
+    bool isValid() const { return m_rounds != 0; }
+    QAESEncryption::Aes level() const { return m_level; }
+    int rounds() const { return m_rounds; }
+
+    /// Big-endian round key words for the T-table core.
+    const quint32 *encryptionWords() const { return m_encryptionWords; }
+    const quint32 *decryptionWords() const { return m_decryptionWords; }
+    /// The same schedules laid out byte by byte, as the AES-NI routines expect them.
+    const char *encryptionKeyBytes() const { return m_encryptionBytes; }
+    const char *decryptionKeyBytes() const { return m_decryptionBytes; }
+
+private:
+    /// Largest schedule: AES-256 has 15 round keys of 4 words each.
+    static constexpr int kMaxRoundKeyWords = 60;
+
+    QAESEncryption::Aes m_level = QAESEncryption::AES_128;
+    int m_rounds = 0;
+    quint32 m_encryptionWords[kMaxRoundKeyWords] = {};
+    quint32 m_decryptionWords[kMaxRoundKeyWords] = {};
+    alignas(16) char m_encryptionBytes[kMaxRoundKeyWords * 4] = {};
+    alignas(16) char m_decryptionBytes[kMaxRoundKeyWords * 4] = {};
+};
+
+#endif // QAESENCRYPTION_H
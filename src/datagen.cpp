@@ -1,41 +1,40 @@
+#include "crypto/base64.h"
+#include "crypto/ledgerkey.h"
+#include "crypto/md5batch.h"
 #include "crypto/qaesencryption.h"
+#include "ledger/binaryledger.h"
+#include "ledger/jsonledgerwriter.h"
+#include "ledger/jsonrecordstream.h"
+#include "ledger/ledger.h"
+#include "ledger/ledgerfile.h"
 
 #include <QApplication>
-#include <QCryptographicHash>
+#include <QCommandLineParser>
 #include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QFormLayout>
 #include <QHBoxLayout>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
 #include <QLabel>
 #include <QLineEdit>
 #include <QListWidget>
 #include <QMessageBox>
 #include <QPushButton>
+#include <QRandomGenerator>
 #include <QRegularExpression>
+#include <QSaveFile>
 #include <QVBoxLayout>
+#include <QTextStream>
 #include <QWidget>
 
+#include <algorithm>
+
 namespace {
 constexpr auto kDefaultBasename = "transactions_generated";
 
-const QByteArray &aesKey()
-{
-    static const QByteArray key = QByteArray::fromHex(
-        "ab9f5f69737f3f02f1e2a6d17305eae239f2bba9d6a8ed5e322ad87d3654c9d8"
-    );
-    return key;
-}
-
-const QByteArray &aesIv()
-{
-    static const QByteArray iv = QByteArray::fromHex("1af38c2dc2b96ffdd86694092341bc04");
-    return iv;
-}
-
 QString computeHash(const QString &article, int quantity, qint64 timestamp, const QString &previousHash)
 {
     QByteArray payload;
@@ -44,34 +43,37 @@ QString computeHash(const QString &article, int quantity, qint64 timestamp, cons
     payload.append(QByteArray::number(timestamp));
     payload.append(previousHash.toUtf8());
 
-    const QByteArray digest = QCryptographicHash::hash(payload, QCryptographicHash::Md5);
-    return QString::fromLatin1(digest.toBase64());
+    return QString::fromLatin1(crypto::md5(payload).toByteArray().toBase64());
 }
 
-bool writeFile(const QString &path, const QByteArray &data)
+void showWriteError(const QString &path, const QString &error)
 {
-    QFile file(path);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        QMessageBox::critical(nullptr, QObject::tr("Ошибка записи"),
-                              QObject::tr("Не удалось записать \"%1\": %2")
-                                  .arg(path, file.errorString()));
-        return false;
+    QMessageBox::critical(nullptr, QObject::tr("Ошибка записи"),
+                          QObject::tr("Не удалось записать \"%1\": %2")
+                              .arg(path, error));
+}
+
+// Output goes through QSaveFile: it writes a temporary file next to the target and
+// renames it over the target on commit(), so a failed export leaves the old file intact.
+bool openForWriting(QSaveFile &file)
+{
+    if (file.open(QIODevice::WriteOnly)) {
+        return true;
     }
-    if (file.write(data) != data.size()) {
-        QMessageBox::critical(nullptr, QObject::tr("Ошибка записи"),
-                              QObject::tr("Не удалось полностью записать \"%1\".")
-                                  .arg(path));
-        return false;
+    showWriteError(file.fileName(), file.errorString());
+    return false;
+}
+
+bool commitFile(QSaveFile &file)
+{
+    if (file.commit()) {
+        return true;
     }
-    return true;
+    showWriteError(file.fileName(), file.errorString());
+    return false;
 }
 
-struct Entry {
-    QString article;
-    int quantity = 0;
-    qint64 timestamp = 0;
-    QString hash;
-};
+using Entry = ledger::Transaction;
 
 class GeneratorWindow : public QWidget
 {
@@ -79,6 +81,7 @@ class GeneratorWindow : public QWidget
 
 public:
     GeneratorWindow()
+        : m_keySchedule(QAESEncryption::AES_256, crypto::ledgerKey())
     {
         setWindowTitle(tr("Генератор транзакций"));
         resize(640, 480);
@@ -107,12 +110,14 @@ public:
 
         auto *addButton = new QPushButton(tr("Добавить"), this);
         auto *resetButton = new QPushButton(tr("Сбросить"), this);
+        auto *importButton = new QPushButton(tr("Импорт…"), this);
         m_exportButton = new QPushButton(tr("Экспортировать"), this);
         m_exportButton->setEnabled(false);
 
         buttonRow->addWidget(addButton);
         buttonRow->addWidget(resetButton);
         buttonRow->addStretch(1);
+        buttonRow->addWidget(importButton);
         buttonRow->addWidget(m_exportButton);
 
         layout->addLayout(buttonRow);
@@ -125,6 +130,7 @@ public:
 
         connect(addButton, &QPushButton::clicked, this, &GeneratorWindow::onAdd);
         connect(resetButton, &QPushButton::clicked, this, &GeneratorWindow::onReset);
+        connect(importButton, &QPushButton::clicked, this, &GeneratorWindow::onImport);
         connect(m_exportButton, &QPushButton::clicked, this, &GeneratorWindow::onExport);
 
         updateTimestampField();
@@ -163,19 +169,16 @@ private slots:
         }
 
         const QString hash = computeHash(article, quantity, timestamp,
-                                         m_entries.isEmpty() ? QString() : m_entries.constLast().hash);
+                                         m_entries.isEmpty() ? QString() : m_entries.constLast().storedHash);
 
-        Entry entry{article, quantity, timestamp, hash};
+        Entry entry;
+        entry.article = article;
+        entry.quantity = quantity;
+        entry.shipmentTimestamp = timestamp;
+        entry.storedHash = hash;
         m_entries.append(entry);
 
-        const QString display = tr("%1 | %2 | %3 | %4")
-                                    .arg(article)
-                                    .arg(quantity)
-                                    .arg(QDateTime::fromSecsSinceEpoch(timestamp, Qt::UTC)
-                                             .toString(QStringLiteral("yyyy-MM-dd HH:mm:ss")))
-                                    .arg(hash);
-
-        m_listWidget->addItem(display);
+        addListItem(entry);
         m_listWidget->scrollToBottom();
 
         m_statusLabel->setText(tr("Добавлено записей: %1").arg(m_entries.count()));
@@ -198,6 +201,50 @@ private slots:
         updateTimestampField();
     }
 
+    void onImport()
+    {
+        const QString path = QFileDialog::getOpenFileName(
+            this,
+            tr("Импорт транзакций"),
+            QDir::currentPath(),
+            tr("Файлы транзакций (*.json *.enc *.txl)")
+        );
+        if (path.isEmpty()) {
+            return;
+        }
+
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            QMessageBox::critical(this, tr("Ошибка чтения"),
+                                  tr("Не удалось открыть \"%1\": %2").arg(path, file.errorString()));
+            return;
+        }
+
+        ledger::Ledger loaded;
+        QString error;
+        const ledger::StreamResult result =
+            ledger::readLedgerFile(file, m_keySchedule, crypto::ledgerIv(), loaded);
+        if (result.error == ledger::StreamError::Decrypt) {
+            error = tr("не удалось выполнить расшифровку AES-256");
+        } else if (result.error != ledger::StreamError::None) {
+            error = result.errorString;
+        }
+        if (!error.isEmpty()) {
+            QMessageBox::critical(this, tr("Ошибка формата"),
+                                  tr("Не удалось импортировать \"%1\": %2.").arg(path, error));
+            return;
+        }
+
+        onReset();
+        m_entries.reserve(loaded.size());
+        for (qsizetype i = 0; i < loaded.size(); ++i) {
+            m_entries.append(loaded.transaction(i));
+            addListItem(m_entries.constLast());
+        }
+        m_statusLabel->setText(tr("Импортировано записей: %1").arg(m_entries.count()));
+        m_exportButton->setEnabled(!m_entries.isEmpty());
+    }
+
     void onExport()
     {
         if (m_entries.isEmpty()) {
@@ -217,38 +264,56 @@ private slots:
         }
 
         const QString basePath = jsonPath;
-        QJsonArray array;
-        for (const Entry &entry : std::as_const(m_entries)) {
-            QJsonObject object;
-            object.insert(QStringLiteral("article"), entry.article);
-            object.insert(QStringLiteral("quantity"), entry.quantity);
-            object.insert(QStringLiteral("timestamp"), static_cast<qint64>(entry.timestamp));
-            object.insert(QStringLiteral("hash"), entry.hash);
-            array.append(object);
+        const QString encPath = basePath + QStringLiteral(".enc");
+        const QFileInfo jsonInfo(basePath);
+        const QString ledgerPath = jsonInfo.dir().filePath(jsonInfo.completeBaseName() + QStringLiteral(".txl"));
+        // Nothing is committed until all three files are written, so a failure leaves
+        // every previous export untouched rather than a mismatched set.
+        QSaveFile jsonFile(basePath);
+        QSaveFile encFile(encPath);
+        QSaveFile ledgerFile(ledgerPath);
+        if (!openForWriting(jsonFile) || !openForWriting(encFile) || !openForWriting(ledgerFile)) {
+            return;
         }
 
-        const QJsonDocument document(array);
-        const QByteArray jsonBytes = document.toJson(QJsonDocument::Indented);
-
-        if (!writeFile(basePath, jsonBytes)) {
+        // Records are serialized, encrypted and encoded a buffer at a time, so the
+        // export needs no copy of the whole document in any of its forms.
+        ledger::JsonLedgerWriter writer(&jsonFile, &encFile, m_keySchedule, crypto::ledgerIv());
+        for (const Entry &entry : std::as_const(m_entries)) {
+            if (!writer.append(entry.article.toUtf8(), entry.quantity, entry.shipmentTimestamp,
+                               entry.storedHash.toUtf8())) {
+                break;
+            }
+        }
+        if (!writer.finish()) {
+            showWriteError(basePath, writer.errorString());
             return;
         }
-
-        QAESEncryption aes(QAESEncryption::AES_256, QAESEncryption::CBC, QAESEncryption::PKCS7);
-        const QByteArray cipher = aes.encode(jsonBytes, aesKey(), aesIv());
-        const QByteArray encoded = cipher.toBase64();
-
-        const QString encPath = basePath + QStringLiteral(".enc");
-        if (!writeFile(encPath, encoded)) {
+        QString error;
+        if (!ledger::writeBinaryLedger(ledgerFile, m_entries, &error)) {
+            showWriteError(ledgerPath, error);
+            return;
+        }
+        if (!commitFile(jsonFile) || !commitFile(encFile) || !commitFile(ledgerFile)) {
             return;
         }
 
         QMessageBox::information(this, tr("Готово"),
-                                 tr("Файлы сохранены:\n%1\n%2")
-                                     .arg(basePath, encPath));
+                                 tr("Файлы сохранены:\n%1\n%2\n%3")
+                                     .arg(basePath, encPath, ledgerPath));
     }
 
 private:
+    void addListItem(const Entry &entry)
+    {
+        m_listWidget->addItem(tr("%1 | %2 | %3 | %4")
+                                  .arg(entry.article)
+                                  .arg(entry.quantity)
+                                  .arg(QDateTime::fromSecsSinceEpoch(entry.shipmentTimestamp, Qt::UTC)
+                                           .toString(QStringLiteral("yyyy-MM-dd HH:mm:ss")))
+                                  .arg(entry.storedHash));
+    }
+
     void updateTimestampField()
     {
         m_timestampEdit->setText(QString::number(QDateTime::currentSecsSinceEpoch()));
@@ -260,13 +325,226 @@ private:
     QListWidget *m_listWidget = nullptr;
     QLabel *m_statusLabel = nullptr;
     QPushButton *m_exportButton = nullptr;
-    QList<Entry> m_entries;
+    QVector<Entry> m_entries;
+    const QAESKeySchedule m_keySchedule;
+};
+
+
+// Exit codes of the batch mode.
+enum ExitCode {
+    ExitSuccess = 0,
+    ExitFailure = 1,
+    ExitUsage = 64
+};
+
+// Articles match what the form accepts: exactly ten digits.
+constexpr quint64 kArticleRange = 10000000000ull;
+// Records between progress lines.
+constexpr qint64 kProgressStep = 1 << 20;
+
+struct GenerateOptions {
+    qint64 count = 0;
+    QString jsonPath;
+    bool writeJson = true;
+    bool writeEncrypted = true;
+    qint64 startTimestamp = 0;
+    double recordsPerSecond = 1.0;
+    int maxQuantity = 1000;
+    quint32 seed = 1;
+    /// Sorted record indices whose quantity is changed after hashing.
+    QVector<qint64> breaks;
 };
 
+bool parseGenerateOptions(const QStringList &arguments, GenerateOptions &options, QTextStream &err)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QObject::tr(
+        "Генерирует синтетический журнал отгрузок с цепочкой хешей без загрузки его в память."));
+    parser.addHelpOption();
+    const QCommandLineOption countOption({QStringLiteral("n"), QStringLiteral("count")},
+                                         QObject::tr("Число записей."), QStringLiteral("n"));
+    const QCommandLineOption outputOption({QStringLiteral("o"), QStringLiteral("output")},
+                                          QObject::tr("Путь к JSON; зашифрованная копия получает суффикс .enc."),
+                                          QStringLiteral("path"),
+                                          QStringLiteral("%1.json").arg(kDefaultBasename));
+    const QCommandLineOption formatOption(QStringLiteral("format"),
+                                          QObject::tr("Что записывать: json, enc или both."),
+                                          QStringLiteral("format"), QStringLiteral("both"));
+    const QCommandLineOption startOption(QStringLiteral("start"),
+                                         QObject::tr("Unix timestamp первой записи (по умолчанию сейчас)."),
+                                         QStringLiteral("timestamp"));
+    const QCommandLineOption rateOption(QStringLiteral("rate"),
+                                        QObject::tr("Отгрузок в секунду, задаёт шаг timestamp."),
+                                        QStringLiteral("records"), QStringLiteral("1"));
+    const QCommandLineOption quantityOption(QStringLiteral("max-quantity"),
+                                            QObject::tr("Наибольшее количество в записи."),
+                                            QStringLiteral("n"), QString::number(options.maxQuantity));
+    const QCommandLineOption seedOption(QStringLiteral("seed"),
+                                        QObject::tr("Начальное значение генератора, для повторяемых файлов."),
+                                        QStringLiteral("n"), QString::number(options.seed));
+    const QCommandLineOption breakOption(QStringLiteral("break"),
+                                         QObject::tr("Индексы записей (с нуля, через запятую), "
+                                                     "у которых цепочка должна нарушиться."),
+                                         QStringLiteral("indices"));
+    parser.addOptions({countOption, outputOption, formatOption, startOption, rateOption, quantityOption,
+                       seedOption, breakOption});
+    parser.process(arguments);
+
+    const auto fail = [&](const QString &message) {
+        err << message << Qt::endl;
+        return false;
+    };
+    bool ok = false;
+    options.count = parser.value(countOption).toLongLong(&ok);
+    if (!ok || options.count < 0) {
+        return fail(QObject::tr("Укажите число записей: --count <n>."));
+    }
+    options.jsonPath = parser.value(outputOption);
+    const QString format = parser.value(formatOption);
+    options.writeJson = format == QLatin1String("json") || format == QLatin1String("both");
+    options.writeEncrypted = format == QLatin1String("enc") || format == QLatin1String("both");
+    if (!options.writeJson && !options.writeEncrypted) {
+        return fail(QObject::tr("Неизвестный формат \"%1\".").arg(format));
+    }
+    options.startTimestamp = QDateTime::currentSecsSinceEpoch();
+    if (parser.isSet(startOption)) {
+        options.startTimestamp = parser.value(startOption).toLongLong(&ok);
+        if (!ok) {
+            return fail(QObject::tr("Неверный timestamp \"%1\".").arg(parser.value(startOption)));
+        }
+    }
+    options.recordsPerSecond = parser.value(rateOption).toDouble(&ok);
+    if (!ok || !(options.recordsPerSecond > 0)) {
+        return fail(QObject::tr("Частота должна быть положительным числом."));
+    }
+    options.maxQuantity = parser.value(quantityOption).toInt(&ok);
+    if (!ok || options.maxQuantity < 1) {
+        return fail(QObject::tr("Наибольшее количество должно быть положительным."));
+    }
+    options.seed = parser.value(seedOption).toUInt(&ok);
+    if (!ok) {
+        return fail(QObject::tr("Неверное начальное значение \"%1\".").arg(parser.value(seedOption)));
+    }
+    if (parser.isSet(breakOption)) {
+        for (const QString &item : parser.value(breakOption).split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+            const qint64 index = item.trimmed().toLongLong(&ok);
+            if (!ok || index < 0 || index >= options.count) {
+                return fail(QObject::tr("Индекс нарушения \"%1\" вне журнала.").arg(item));
+            }
+            options.breaks.append(index);
+        }
+        std::sort(options.breaks.begin(), options.breaks.end());
+        options.breaks.erase(std::unique(options.breaks.begin(), options.breaks.end()), options.breaks.end());
+    }
+    return true;
+}
+
+// The chain is built as records are produced, so only the previous hash is kept and
+// a multi-gigabyte ledger needs no more memory than a small one.
+int runGenerate(const QStringList &arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    GenerateOptions options;
+    if (!parseGenerateOptions(arguments, options, err)) {
+        return ExitUsage;
+    }
+
+    const QString encPath = options.jsonPath + QStringLiteral(".enc");
+    // Written to temporary files and renamed into place on success, like the export.
+    QSaveFile jsonFile(options.jsonPath);
+    QSaveFile encFile(encPath);
+    const QList<QSaveFile *> outputs = {options.writeJson ? &jsonFile : nullptr,
+                                        options.writeEncrypted ? &encFile : nullptr};
+    for (QSaveFile *file : outputs) {
+        if (file && !file->open(QIODevice::WriteOnly)) {
+            err << QObject::tr("Не удалось записать \"%1\": %2").arg(file->fileName(), file->errorString())
+                << Qt::endl;
+            return ExitFailure;
+        }
+    }
+
+    const QAESKeySchedule schedule(QAESEncryption::AES_256, crypto::ledgerKey());
+    ledger::JsonLedgerWriter writer(options.writeJson ? &jsonFile : nullptr,
+                                    options.writeEncrypted ? &encFile : nullptr, schedule, crypto::ledgerIv());
+    QRandomGenerator random(options.seed);
+    QByteArray payload;
+    QByteArray previousHash;
+    qsizetype nextBreak = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    for (qint64 i = 0; i < options.count; ++i) {
+        const QByteArray article =
+            QByteArray::number(random.generate64() % kArticleRange).rightJustified(10, '0');
+        const int quantity = 1 + int(random.bounded(options.maxQuantity));
+        const qint64 timestamp = options.startTimestamp + qint64(double(i) / options.recordsPerSecond);
+
+        payload.resize(0);
+        payload.append(article);
+        payload.append(QByteArray::number(quantity));
+        payload.append(QByteArray::number(timestamp));
+        payload.append(previousHash);
+        const crypto::Md5Digest digest = crypto::md5(payload);
+        previousHash = crypto::base64Encode(
+            QByteArrayView(reinterpret_cast<const char *>(digest.bytes.data()), qsizetype(digest.bytes.size())));
+
+        // A break keeps the stored hash and changes a field it covers, so exactly this
+        // record fails and the chain resumes after it, as with a hand-edited file.
+        int storedQuantity = quantity;
+        if (nextBreak < options.breaks.size() && options.breaks.at(nextBreak) == i) {
+            storedQuantity = quantity + 1;
+            ++nextBreak;
+        }
+        if (!writer.append(article, storedQuantity, timestamp, previousHash)) {
+            break;
+        }
+        if ((i + 1) % kProgressStep == 0) {
+            err << QObject::tr("Записано %1 из %2").arg(i + 1).arg(options.count) << Qt::endl;
+        }
+    }
+
+    if (!writer.finish()) {
+        err << QObject::tr("Ошибка записи: %1").arg(writer.errorString()) << Qt::endl;
+        return ExitFailure;
+    }
+    for (QSaveFile *file : outputs) {
+        if (file && !file->commit()) {
+            err << QObject::tr("Не удалось записать \"%1\": %2").arg(file->fileName(), file->errorString())
+                << Qt::endl;
+            return ExitFailure;
+        }
+    }
+
+    const double seconds = qMax(1e-9, double(timer.nsecsElapsed()) / 1e9);
+    const double megabytes = double(writer.jsonSize() + writer.encryptedSize()) / (1024.0 * 1024.0);
+    out << QObject::tr("Записей: %1, нарушений: %2, за %3 с (%4 МБ/с)")
+               .arg(writer.recordCount())
+               .arg(options.breaks.size())
+               .arg(seconds, 0, 'f', 2)
+               .arg(megabytes / seconds, 0, 'f', 1)
+        << Qt::endl;
+    if (options.writeJson) {
+        out << options.jsonPath << Qt::endl;
+    }
+    if (options.writeEncrypted) {
+        out << encPath << Qt::endl;
+    }
+    return ExitSuccess;
+}
 } // namespace
 
 int main(int argc, char *argv[])
 {
+    // "transactions_tool generate ..." runs without a window, so it also works on
+    // machines without a display.
+    if (argc > 1 && qstrcmp(argv[1], "generate") == 0) {
+        QCoreApplication app(argc, argv);
+        QStringList arguments = QCoreApplication::arguments();
+        arguments.removeAt(1);
+        return runGenerate(arguments);
+    }
+
     QApplication app(argc, argv);
     GeneratorWindow window;
     window.show();
@@ -274,4 +552,3 @@ int main(int argc, char *argv[])
 }
 
 #include "datagen.moc"
-#include <QCryptographicHash>
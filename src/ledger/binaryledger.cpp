@@ -0,0 +1,480 @@
+#include "binaryledger.h"
+
+#include "crypto/base64.h"
+
+#include <QFileDevice>
+#include <QIODevice>
+#include <QObject>
+#include <QtEndian>
+
+#include <cstring>
+#include <limits>
+
+namespace ledger {
+namespace {
+
+using namespace binary;
+
+constexpr int kMaxArticleWidth = 19;
+constexpr qint64 kColumnAlignment = 16;
+constexpr qsizetype kWriteBuffer = 64 * 1024;
+
+struct ColumnEntry {
+    quint32 id = 0;
+    quint32 elementSize = 0;
+    quint64 offset = 0;
+    quint64 count = 0;
+};
+
+// Buffers small writes and keeps track of the file position for the footer index.
+class ColumnWriter
+{
+public:
+    explicit ColumnWriter(QIODevice &device)
+        : m_device(device)
+    {
+        m_buffer.reserve(kWriteBuffer);
+    }
+
+    template<typename T>
+    void appendLe(T value)
+    {
+        char bytes[sizeof(T)];
+        qToLittleEndian(value, bytes);
+        append(bytes, sizeof(T));
+    }
+
+    void append(const void *data, qsizetype size)
+    {
+        m_buffer.append(static_cast<const char *>(data), size);
+        m_position += size;
+        if (m_buffer.size() >= kWriteBuffer)
+            flush();
+    }
+
+    void beginColumn(quint32 id, quint32 elementSize, quint64 count)
+    {
+        static const char padding[kColumnAlignment] = {};
+        if (const qint64 misalignment = m_position % kColumnAlignment)
+            append(padding, kColumnAlignment - misalignment);
+        m_columns.push_back({id, elementSize, quint64(m_position), count});
+    }
+
+    bool flush()
+    {
+        if (!m_buffer.isEmpty() && m_device.write(m_buffer) != m_buffer.size())
+            m_failed = true;
+        m_buffer.resize(0);
+        return !m_failed;
+    }
+
+    qint64 position() const { return m_position; }
+    const QVector<ColumnEntry> &columns() const { return m_columns; }
+
+private:
+    QIODevice &m_device;
+    QByteArray m_buffer;
+    qint64 m_position = 0;
+    bool m_failed = false;
+    QVector<ColumnEntry> m_columns;
+};
+
+// The fields of a record the way the columns store them. Each column is written in
+// its own pass over the source, so a source is read several times.
+class LedgerSource
+{
+public:
+    explicit LedgerSource(const Ledger &ledger)
+        : m_ledger(ledger)
+    {
+    }
+
+    qsizetype size() const { return m_ledger.size(); }
+    int articleWidth() const { return m_ledger.articleWidth(); }
+    /// False when the article is stored as text instead.
+    bool articleId(qsizetype index, quint64 *id) const
+    {
+        *id = m_ledger.articleId(index);
+        return m_ledger.hasPackedArticle(index);
+    }
+    QByteArray articleText(qsizetype index) const { return m_ledger.article(index).toUtf8(); }
+    int quantity(qsizetype index) const { return m_ledger.quantity(index); }
+    qint64 timestamp(qsizetype index) const { return m_ledger.timestamp(index); }
+    /// False when the hash is stored as text instead.
+    bool digest(qsizetype index, crypto::Md5Digest *digest) const
+    {
+        const crypto::Md5Digest *stored = m_ledger.storedDigest(index);
+        if (stored)
+            *digest = *stored;
+        return stored != nullptr;
+    }
+    QByteArray hashText(qsizetype index) const { return m_ledger.storedHash(index).toUtf8(); }
+
+private:
+    const Ledger &m_ledger;
+};
+
+// Packs plain records with the rules Ledger::append() applies, one field at a time.
+class TransactionSource
+{
+public:
+    explicit TransactionSource(const QVector<Transaction> &records)
+        : m_records(records)
+    {
+        // Like Ledger, take the width of the first article that is all digits.
+        for (const Transaction &record : records) {
+            const QByteArray article = record.article.toUtf8();
+            if (!article.isEmpty() && article.size() <= kMaxArticleWidth && isDigits(article)) {
+                m_articleWidth = int(article.size());
+                break;
+            }
+        }
+    }
+
+    qsizetype size() const { return m_records.size(); }
+    int articleWidth() const { return m_articleWidth; }
+    bool articleId(qsizetype index, quint64 *id) const
+    {
+        *id = 0;
+        const QByteArray article = articleText(index);
+        if (m_articleWidth == 0 || article.size() != m_articleWidth || !isDigits(article))
+            return false;
+        for (const char c : article)
+            *id = *id * 10 + quint64(c - '0');
+        return true;
+    }
+    QByteArray articleText(qsizetype index) const { return m_records.at(index).article.toUtf8(); }
+    int quantity(qsizetype index) const { return m_records.at(index).quantity; }
+    qint64 timestamp(qsizetype index) const { return m_records.at(index).shipmentTimestamp; }
+    bool digest(qsizetype index, crypto::Md5Digest *digest) const
+    {
+        // Only text that encodes back to itself is stored raw, so reading is lossless.
+        const QByteArray text = hashText(index);
+        bool ok = false;
+        const QByteArray bytes = crypto::base64Decode(text, &ok);
+        if (!ok || bytes.size() != kHashSize || crypto::base64Encode(bytes) != text)
+            return false;
+        std::memcpy(digest->bytes.data(), bytes.constData(), kHashSize);
+        return true;
+    }
+    QByteArray hashText(qsizetype index) const { return m_records.at(index).storedHash.toUtf8(); }
+
+private:
+    static bool isDigits(QByteArrayView text)
+    {
+        for (const char c : text) {
+            if (c < '0' || c > '9')
+                return false;
+        }
+        return true;
+    }
+
+    const QVector<Transaction> &m_records;
+    int m_articleWidth = 0;
+};
+
+template<typename Source>
+bool writeColumns(QIODevice &device, const Source &source, QString *errorString)
+{
+    const qsizetype count = source.size();
+    const int articleWidth = source.articleWidth();
+
+    // Values the packed columns cannot hold go to the string heap.
+    QVector<quint64> articleExceptions;
+    QVector<quint64> hashExceptions;
+    QByteArray heap;
+    auto addToHeap = [&heap](QVector<quint64> &exceptions, qsizetype index, const QByteArray &utf8) {
+        exceptions.push_back(quint64(index));
+        exceptions.push_back(quint64(heap.size()));
+        char length[4];
+        qToLittleEndian(quint32(utf8.size()), length);
+        heap.append(length, 4);
+        heap.append(utf8);
+    };
+    quint64 articleId = 0;
+    crypto::Md5Digest digest;
+    for (qsizetype i = 0; i < count; ++i) {
+        if (!source.articleId(i, &articleId))
+            addToHeap(articleExceptions, i, source.articleText(i));
+        if (!source.digest(i, &digest))
+            addToHeap(hashExceptions, i, source.hashText(i));
+    }
+
+    ColumnWriter writer(device);
+    writer.append(kMagic, sizeof(kMagic));
+    writer.appendLe<quint32>(kVersion);
+    writer.appendLe<quint32>(quint32(articleWidth));
+
+    writer.beginColumn(ArticleColumn, 8, quint64(count));
+    for (qsizetype i = 0; i < count; ++i) {
+        source.articleId(i, &articleId);
+        writer.appendLe<quint64>(articleId);
+    }
+
+    writer.beginColumn(QuantityColumn, 4, quint64(count));
+    for (qsizetype i = 0; i < count; ++i)
+        writer.appendLe<qint32>(source.quantity(i));
+
+    writer.beginColumn(TimestampColumn, 8, quint64(count));
+    for (qsizetype i = 0; i < count; ++i)
+        writer.appendLe<qint64>(source.timestamp(i));
+
+    writer.beginColumn(HashColumn, kHashSize, quint64(count));
+    for (qsizetype i = 0; i < count; ++i) {
+        if (!source.digest(i, &digest))
+            digest = crypto::Md5Digest();
+        writer.append(digest.bytes.data(), kHashSize);
+    }
+    writer.beginColumn(ArticleExceptionColumn, 16, quint64(articleExceptions.size() / 2));
+    for (const quint64 value : articleExceptions)
+        writer.appendLe<quint64>(value);
+
+    writer.beginColumn(HashExceptionColumn, 16, quint64(hashExceptions.size() / 2));
+    for (const quint64 value : hashExceptions)
+        writer.appendLe<quint64>(value);
+
+    writer.beginColumn(StringHeapColumn, 1, quint64(heap.size()));
+    writer.append(heap.constData(), heap.size());
+
+    const QVector<ColumnEntry> columns = writer.columns();
+    const qint64 footerOffset = writer.position();
+    writer.appendLe<quint32>(quint32(columns.size()));
+    writer.appendLe<quint32>(0);
+    for (const ColumnEntry &column : columns) {
+        writer.appendLe<quint32>(column.id);
+        writer.appendLe<quint32>(column.elementSize);
+        writer.appendLe<quint64>(column.offset);
+        writer.appendLe<quint64>(column.count);
+    }
+
+    writer.appendLe<quint64>(quint64(footerOffset));
+    writer.appendLe<quint64>(quint64(count));
+    writer.append(kTrailerMagic, sizeof(kTrailerMagic));
+
+    if (!writer.flush()) {
+        if (errorString)
+            *errorString = device.errorString();
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool BinaryLedgerReader::hasMagic(QByteArrayView prefix)
+{
+    return prefix.size() >= qsizetype(sizeof(kMagic)) && std::memcmp(prefix.data(), kMagic, sizeof(kMagic)) == 0;
+}
+
+bool BinaryLedgerReader::fail(const QString &message)
+{
+    m_errorString = message;
+    m_count = 0;
+    return false;
+}
+
+bool BinaryLedgerReader::map(QFileDevice &file)
+{
+    const qint64 size = file.size();
+    if (size <= 0)
+        return fail(QObject::tr("файл пуст"));
+    const uchar *mapped = file.map(0, size);
+    if (!mapped)
+        return fail(file.errorString());
+    return open(QByteArrayView(reinterpret_cast<const char *>(mapped), size));
+}
+
+bool BinaryLedgerReader::open(QByteArrayView image)
+{
+    m_image = image;
+    const auto *data = reinterpret_cast<const uchar *>(image.data());
+    const qint64 size = image.size();
+
+    if (size < kHeaderSize + kTrailerSize || !hasMagic(image))
+        return fail(QObject::tr("не является бинарным журналом"));
+    if (qFromLittleEndian<quint32>(data + 8) != kVersion)
+        return fail(QObject::tr("неподдерживаемая версия формата %1").arg(qFromLittleEndian<quint32>(data + 8)));
+    m_articleWidth = int(qFromLittleEndian<quint32>(data + 12));
+    if (m_articleWidth > kMaxArticleWidth)
+        return fail(QObject::tr("повреждён заголовок"));
+
+    const uchar *trailer = data + size - kTrailerSize;
+    if (std::memcmp(trailer + 16, kTrailerMagic, sizeof(kTrailerMagic)) != 0)
+        return fail(QObject::tr("файл обрезан или повреждён"));
+    const quint64 footerOffset = qFromLittleEndian<quint64>(trailer);
+    const quint64 recordCount = qFromLittleEndian<quint64>(trailer + 8);
+    const quint64 footerLimit = quint64(size - kTrailerSize);
+    // Compared against the limit rather than offset + 8, which a huge offset wraps.
+    if (footerOffset < quint64(kHeaderSize) || footerLimit < 8 || footerOffset > footerLimit - 8
+        || recordCount > quint64(std::numeric_limits<qsizetype>::max()))
+        return fail(QObject::tr("повреждён индекс столбцов"));
+
+    const quint32 columnCount = qFromLittleEndian<quint32>(data + footerOffset);
+    if (quint64(columnCount) * 24 > footerLimit - footerOffset - 8)
+        return fail(QObject::tr("повреждён индекс столбцов"));
+
+    m_articles = m_quantities = m_timestamps = m_hashes = Column();
+    m_articleExceptions = m_hashExceptions = m_heap = Column();
+    for (quint32 i = 0; i < columnCount; ++i) {
+        const uchar *entry = data + footerOffset + 8 + i * 24;
+        const quint32 id = qFromLittleEndian<quint32>(entry);
+        const quint32 elementSize = qFromLittleEndian<quint32>(entry + 4);
+        const quint64 offset = qFromLittleEndian<quint64>(entry + 8);
+        const quint64 count = qFromLittleEndian<quint64>(entry + 16);
+        if (elementSize == 0 || offset < quint64(kHeaderSize) || offset > footerOffset
+            || count > (footerOffset - offset) / elementSize)
+            return fail(QObject::tr("столбец %1 выходит за пределы файла").arg(id));
+
+        Column *column = nullptr;
+        quint32 expectedSize = 0;
+        switch (id) {
+        case ArticleColumn: column = &m_articles; expectedSize = 8; break;
+        case QuantityColumn: column = &m_quantities; expectedSize = 4; break;
+        case TimestampColumn: column = &m_timestamps; expectedSize = 8; break;
+        case HashColumn: column = &m_hashes; expectedSize = kHashSize; break;
+        case ArticleExceptionColumn: column = &m_articleExceptions; expectedSize = 16; break;
+        case HashExceptionColumn: column = &m_hashExceptions; expectedSize = 16; break;
+        case StringHeapColumn: column = &m_heap; expectedSize = 1; break;
+        default: continue; // Columns added by later versions are ignored.
+        }
+        if (elementSize != expectedSize)
+            return fail(QObject::tr("столбец %1 имеет неверный размер элемента").arg(id));
+        column->data = data + offset;
+        column->count = count;
+    }
+
+    for (const Column *column : {&m_articles, &m_quantities, &m_timestamps, &m_hashes}) {
+        if (!column->data || column->count != recordCount)
+            return fail(QObject::tr("отсутствует обязательный столбец"));
+    }
+    // exceptionText() binary-searches these lists, so an unsorted one would silently
+    // hide values instead of failing.
+    for (const Column *column : {&m_articleExceptions, &m_hashExceptions}) {
+        if (!exceptionsSorted(*column, recordCount))
+            return fail(QObject::tr("список исключений повреждён"));
+    }
+
+    m_count = qsizetype(recordCount);
+    m_errorString.clear();
+    return true;
+}
+
+bool BinaryLedgerReader::exceptionsSorted(const Column &exceptions, quint64 recordCount)
+{
+    quint64 previous = 0;
+    for (quint64 i = 0; i < exceptions.count; ++i) {
+        const quint64 recordIndex = qFromLittleEndian<quint64>(exceptions.data + i * 16);
+        if (recordIndex >= recordCount || (i > 0 && recordIndex <= previous))
+            return false;
+        previous = recordIndex;
+    }
+    return true;
+}
+
+QByteArrayView BinaryLedgerReader::exceptionText(const Column &exceptions, qsizetype index, bool *found) const
+{
+    *found = false;
+    // Entries are {u64 record index, u64 heap offset}, sorted by index.
+    quint64 low = 0;
+    quint64 high = exceptions.count;
+    while (low < high) {
+        const quint64 middle = low + (high - low) / 2;
+        const quint64 recordIndex = qFromLittleEndian<quint64>(exceptions.data + middle * 16);
+        if (recordIndex < quint64(index)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == exceptions.count || qFromLittleEndian<quint64>(exceptions.data + low * 16) != quint64(index))
+        return QByteArrayView();
+
+    *found = true;
+    const quint64 heapOffset = qFromLittleEndian<quint64>(exceptions.data + low * 16 + 8);
+    if (m_heap.count < 4 || heapOffset > m_heap.count - 4)
+        return QByteArrayView();
+    const quint32 length = qFromLittleEndian<quint32>(m_heap.data + heapOffset);
+    if (length > m_heap.count - heapOffset - 4)
+        return QByteArrayView();
+    return QByteArrayView(reinterpret_cast<const char *>(m_heap.data + heapOffset + 4), qsizetype(length));
+}
+
+QByteArrayView BinaryLedgerReader::articleText(qsizetype index, char *digits) const
+{
+    bool found = false;
+    const QByteArrayView text = exceptionText(m_articleExceptions, index, &found);
+    if (found)
+        return text;
+
+    quint64 value = qFromLittleEndian<quint64>(m_articles.data + index * 8);
+    for (int i = m_articleWidth - 1; i >= 0; --i) {
+        digits[i] = char('0' + value % 10);
+        value /= 10;
+    }
+    return QByteArrayView(digits, m_articleWidth);
+}
+
+QString BinaryLedgerReader::article(qsizetype index) const
+{
+    char digits[kMaxArticleWidth];
+    const QByteArrayView text = articleText(index, digits);
+    return QString::fromUtf8(text.data(), text.size());
+}
+
+int BinaryLedgerReader::quantity(qsizetype index) const
+{
+    return qFromLittleEndian<qint32>(m_quantities.data + index * 4);
+}
+
+qint64 BinaryLedgerReader::timestamp(qsizetype index) const
+{
+    return qFromLittleEndian<qint64>(m_timestamps.data + index * 8);
+}
+
+const quint8 *BinaryLedgerReader::hashDigest(qsizetype index) const
+{
+    bool found = false;
+    exceptionText(m_hashExceptions, index, &found);
+    return found ? nullptr : m_hashes.data + index * kHashSize;
+}
+
+QString BinaryLedgerReader::storedHash(qsizetype index) const
+{
+    bool found = false;
+    const QByteArrayView text = exceptionText(m_hashExceptions, index, &found);
+    if (found)
+        return QString::fromUtf8(text.data(), text.size());
+    const QByteArray digest(reinterpret_cast<const char *>(m_hashes.data + index * kHashSize), kHashSize);
+    return QString::fromLatin1(crypto::base64Encode(digest));
+}
+
+void BinaryLedgerReader::appendTo(Ledger &ledger, qsizetype first, qsizetype count) const
+{
+    const qsizetype end = qMin(m_count, first + count);
+    ledger.reserve(ledger.size() + (end - first));
+    char digits[kMaxArticleWidth];
+    for (qsizetype i = first; i < end; ++i) {
+        const QByteArrayView article = articleText(i, digits);
+        bool found = false;
+        const QByteArrayView hashText = exceptionText(m_hashExceptions, i, &found);
+        if (found) {
+            ledger.append(article, quantity(i), timestamp(i), hashText);
+        } else {
+            crypto::Md5Digest digest;
+            std::memcpy(digest.bytes.data(), m_hashes.data + i * kHashSize, kHashSize);
+            ledger.append(article, quantity(i), timestamp(i), digest);
+        }
+    }
+}
+
+bool writeBinaryLedger(QIODevice &device, const Ledger &ledger, QString *errorString)
+{
+    return writeColumns(device, LedgerSource(ledger), errorString);
+}
+
+bool writeBinaryLedger(QIODevice &device, const QVector<Transaction> &records, QString *errorString)
+{
+    return writeColumns(device, TransactionSource(records), errorString);
+}
+
+} // namespace ledger
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "ledger.h"
+
+#include <QByteArrayView>
+#include <QString>
+
+class QFileDevice;
+class QIODevice;
+
+namespace ledger {
+
+/// On-disk layout of the binary ledger (.txl), all integers little-endian:
+///   header   "TXLEDGER", u32 version, u32 article width
+///   columns  fixed-width arrays, each 16-byte aligned
+///   footer   u32 column count, u32 reserved, then {u32 id, u32 element size, u64 offset, u64 count} per column
+///   trailer  u64 footer offset, u64 record count, "TXLEDEND"
+/// Articles of exactly `article width` digits are packed into a u64 and Base64 hashes
+/// that decode to 16 bytes are stored raw; any other value goes through an exception
+/// list into a string heap, so conversion from JSON is lossless.
+namespace binary {
+
+constexpr char kMagic[8] = {'T', 'X', 'L', 'E', 'D', 'G', 'E', 'R'};
+constexpr char kTrailerMagic[8] = {'T', 'X', 'L', 'E', 'D', 'E', 'N', 'D'};
+constexpr quint32 kVersion = 1;
+constexpr qint64 kHeaderSize = 16;
+constexpr qint64 kTrailerSize = 24;
+constexpr int kHashSize = 16;
+
+enum ColumnId : quint32 {
+    ArticleColumn = 1,
+    QuantityColumn = 2,
+    TimestampColumn = 3,
+    HashColumn = 4,
+    ArticleExceptionColumn = 5,
+    HashExceptionColumn = 6,
+    StringHeapColumn = 7
+};
+
+} // namespace binary
+
+/// Read-only view of a binary ledger. Opening checks the header, trailer, footer index
+/// and the order of the (normally short) exception lists; values are decoded on access.
+class BinaryLedgerReader
+{
+public:
+    /// True if @p prefix starts with the binary ledger magic.
+    static bool hasMagic(QByteArrayView prefix);
+
+    /// Maps @p file, which must stay open while the reader is used.
+    bool map(QFileDevice &file);
+    /// Uses @p image in place; it must outlive the reader.
+    bool open(QByteArrayView image);
+
+    QString errorString() const { return m_errorString; }
+
+    qsizetype size() const { return m_count; }
+    QString article(qsizetype index) const;
+    int quantity(qsizetype index) const;
+    qint64 timestamp(qsizetype index) const;
+    /// Raw digest, or nullptr when the stored hash text is not a canonical 16-byte Base64 value.
+    const quint8 *hashDigest(qsizetype index) const;
+    QString storedHash(qsizetype index) const;
+
+    /// Appends every record to @p ledger; stored digests are copied as is.
+    void appendTo(Ledger &ledger) const { appendTo(ledger, 0, m_count); }
+    /// Appends records [@p first, @p first + @p count).
+    void appendTo(Ledger &ledger, qsizetype first, qsizetype count) const;
+
+private:
+    struct Column {
+        const uchar *data = nullptr;
+        quint64 count = 0;
+    };
+
+    bool fail(const QString &message);
+    /// True if the record indices of @p exceptions strictly increase and stay below @p recordCount.
+    static bool exceptionsSorted(const Column &exceptions, quint64 recordCount);
+    /// UTF-8 text stored for @p index in an exception list; @p found is false if there is none.
+    QByteArrayView exceptionText(const Column &exceptions, qsizetype index, bool *found) const;
+    /// Article as UTF-8, formatted into @p digits when it is packed.
+    QByteArrayView articleText(qsizetype index, char *digits) const;
+
+    QByteArrayView m_image;
+    qsizetype m_count = 0;
+    int m_articleWidth = 0;
+    Column m_articles;
+    Column m_quantities;
+    Column m_timestamps;
+    Column m_hashes;
+    Column m_articleExceptions;
+    Column m_hashExceptions;
+    Column m_heap;
+    QString m_errorString;
+};
+
+/// Writes @p ledger in the binary ledger format. Columns are emitted one after
+/// another followed by the footer, so @p device never needs to seek.
+bool writeBinaryLedger(QIODevice &device, const Ledger &ledger, QString *errorString = nullptr);
+/// Same for a plain record list, packed column by column straight from @p records
+/// without building a Ledger first.
+bool writeBinaryLedger(QIODevice &device, const QVector<Transaction> &records, QString *errorString = nullptr);
+
+} // namespace ledger
@@ -0,0 +1,161 @@
+#include "checkpoints.h"
+
+#include "ledger.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace ledger {
+namespace {
+
+constexpr quint32 kSidecarMagic = 0x5458434b; // "TXCK"
+constexpr quint32 kSidecarVersion = 1;
+constexpr int kDigestSize = 16;
+
+QString canonicalPath(const QString &ledgerPath)
+{
+    return QFileInfo(ledgerPath).canonicalFilePath();
+}
+
+} // namespace
+
+QString ValidationCheckpoints::sidecarPath(const QString &ledgerPath)
+{
+    const QString canonical = canonicalPath(ledgerPath);
+    if (canonical.isEmpty())
+        return QString();
+    const QByteArray key = QCryptographicHash::hash(canonical.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/checkpoints/")
+           + QString::fromLatin1(key) + QStringLiteral(".chk");
+}
+
+bool ValidationCheckpoints::load(const QString &ledgerPath)
+{
+    *this = ValidationCheckpoints();
+    QFile file(sidecarPath(ledgerPath));
+    if (file.fileName().isEmpty() || !file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString path;
+    quint64 seed = 0;
+    quint32 count = 0;
+    in >> magic >> version >> path >> seed >> count;
+    // The file name is only a hash of the path, so the path itself is checked too.
+    if (in.status() != QDataStream::Ok || magic != kSidecarMagic || version != kSidecarVersion
+        || path != canonicalPath(ledgerPath) || seed == 0)
+        return false;
+
+    QVector<Checkpoint> checkpoints;
+    qsizetype begin = 0;
+    for (quint32 i = 0; i < count; ++i) {
+        Checkpoint checkpoint;
+        qint64 end = 0;
+        quint64 fingerprint = 0;
+        quint32 mismatchCount = 0;
+        in >> end >> fingerprint >> mismatchCount;
+        if (in.status() != QDataStream::Ok || end <= begin || quint64(mismatchCount) > quint64(end - begin))
+            return false;
+        checkpoint.end = qsizetype(end);
+        checkpoint.fingerprint = fingerprint;
+        checkpoint.mismatches.reserve(mismatchCount);
+        for (quint32 j = 0; j < mismatchCount; ++j) {
+            qint64 index = 0;
+            crypto::Md5Digest digest;
+            in >> index;
+            if (in.readRawData(reinterpret_cast<char *>(digest.bytes.data()), kDigestSize) != kDigestSize
+                || in.status() != QDataStream::Ok || index < begin || index >= end)
+                return false;
+            checkpoint.mismatches.append(qMakePair(qsizetype(index), digest));
+        }
+        begin = checkpoint.end;
+        checkpoints.append(std::move(checkpoint));
+    }
+    if (!in.atEnd())
+        return false;
+
+    m_checkpoints = std::move(checkpoints);
+    m_seed = seed;
+    return true;
+}
+
+bool ValidationCheckpoints::save(const QString &ledgerPath, const Ledger &ledger)
+{
+    if (ledger.validatedCount() != ledger.size())
+        return false;
+    if (!m_diverged && m_restored == m_checkpoints.size() && restoredEnd() == ledger.size())
+        return true;
+
+    if (m_seed == 0)
+        m_seed = QRandomGenerator::system()->generate64() | 1;
+    m_checkpoints.resize(m_restored);
+    for (qsizetype begin = restoredEnd(); begin < ledger.size();) {
+        Checkpoint checkpoint;
+        // Ends stay on interval boundaries, so a grown file reuses all full segments.
+        checkpoint.end = qMin(ledger.size(), (begin / kInterval + 1) * kInterval);
+        checkpoint.fingerprint = ledger.fingerprint(begin, checkpoint.end - begin, m_seed);
+        for (qsizetype i = begin; i < checkpoint.end; ++i) {
+            const crypto::Md5Digest *stored = ledger.storedDigest(i);
+            if (!stored || *stored != ledger.calculatedDigest(i))
+                checkpoint.mismatches.append(qMakePair(i, ledger.calculatedDigest(i)));
+        }
+        begin = checkpoint.end;
+        m_checkpoints.append(std::move(checkpoint));
+    }
+    m_restored = m_checkpoints.size();
+    m_diverged = false;
+
+    const QString path = sidecarPath(ledgerPath);
+    if (path.isEmpty() || !QDir().mkpath(QFileInfo(path).absolutePath()))
+        return false;
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kSidecarMagic << kSidecarVersion << canonicalPath(ledgerPath) << m_seed << quint32(m_checkpoints.size());
+    for (const Checkpoint &checkpoint : std::as_const(m_checkpoints)) {
+        out << qint64(checkpoint.end) << checkpoint.fingerprint << quint32(checkpoint.mismatches.size());
+        for (const auto &mismatch : checkpoint.mismatches) {
+            out << qint64(mismatch.first);
+            out.writeRawData(reinterpret_cast<const char *>(mismatch.second.bytes.data()), kDigestSize);
+        }
+    }
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+qsizetype ValidationCheckpoints::restore(Ledger &ledger)
+{
+    while (!m_diverged && m_restored < m_checkpoints.size()) {
+        const Checkpoint &checkpoint = m_checkpoints.at(m_restored);
+        const qsizetype begin = restoredEnd();
+        if (checkpoint.end > ledger.size())
+            break;
+        if (ledger.validatedCount() != begin
+            || ledger.fingerprint(begin, checkpoint.end - begin, m_seed) != checkpoint.fingerprint) {
+            m_diverged = true;
+            break;
+        }
+        ledger.restoreValidation(checkpoint.end, checkpoint.mismatches);
+        ++m_restored;
+    }
+    return restoredEnd();
+}
+
+bool ValidationCheckpoints::awaitsSegment(const Ledger &ledger) const
+{
+    return !m_diverged && m_restored < m_checkpoints.size() && ledger.validatedCount() == restoredEnd()
+           && m_checkpoints.at(m_restored).end > ledger.size();
+}
+
+} // namespace ledger
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "crypto/md5batch.h"
+
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+namespace ledger {
+
+class Ledger;
+
+/// Validation results of a ledger file kept in a sidecar in the cache directory, so
+/// reopening the file does not repeat the MD5 work. Records are cut into segments of
+/// kInterval; each checkpoint holds the segment end, a fingerprint of the segment's
+/// content and the few records whose hash did not match. Segments are restored in
+/// order while their fingerprints agree; from the first one that differs, the ledger
+/// is hashed as usual.
+class ValidationCheckpoints
+{
+public:
+    static constexpr qsizetype kInterval = 65536;
+
+    /// Sidecar location for @p ledgerPath, keyed by its canonical path; empty if the
+    /// file does not exist.
+    static QString sidecarPath(const QString &ledgerPath);
+
+    /// Reads the checkpoints saved for @p ledgerPath. A missing, foreign or damaged
+    /// sidecar leaves them empty and returns false.
+    bool load(const QString &ledgerPath);
+    /// Records the state of the fully validated @p ledger and writes it for
+    /// @p ledgerPath, keeping the segments restore() accepted. Writes nothing when the
+    /// sidecar already describes @p ledger.
+    bool save(const QString &ledgerPath, const Ledger &ledger);
+
+    /// Marks every complete, unchanged saved segment of @p ledger as validated,
+    /// stopping at the first one that differs. Returns the records covered so far.
+    qsizetype restore(Ledger &ledger);
+    /// True while the next saved segment may still match but extends past the
+    /// records read so far; validating now would hash records restore() can skip.
+    bool awaitsSegment(const Ledger &ledger) const;
+
+private:
+    struct Checkpoint {
+        /// Index just past the segment's last record.
+        qsizetype end = 0;
+        quint64 fingerprint = 0;
+        QVector<QPair<qsizetype, crypto::Md5Digest>> mismatches;
+    };
+
+    qsizetype restoredEnd() const { return m_restored > 0 ? m_checkpoints.at(m_restored - 1).end : 0; }
+
+    QVector<Checkpoint> m_checkpoints;
+    quint64 m_seed = 0;
+    qsizetype m_restored = 0;
+    bool m_diverged = false;
+};
+
+} // namespace ledger
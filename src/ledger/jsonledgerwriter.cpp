@@ -0,0 +1,126 @@
+#include "jsonledgerwriter.h"
+
+#include <QIODevice>
+#include <QObject>
+
+namespace ledger {
+namespace {
+
+// Text buffered before each write; also the unit the encryptor works on.
+constexpr qsizetype kFlushSize = 256 * 1024;
+
+void appendJsonString(QByteArray &out, QByteArrayView text)
+{
+    static const char kHexDigits[] = "0123456789abcdef";
+    out.append('"');
+    for (const char c : text) {
+        switch (c) {
+        case '"':
+            out.append("\\\"");
+            break;
+        case '\\':
+            out.append("\\\\");
+            break;
+        case '\b':
+            out.append("\\b");
+            break;
+        case '\f':
+            out.append("\\f");
+            break;
+        case '\n':
+            out.append("\\n");
+            break;
+        case '\r':
+            out.append("\\r");
+            break;
+        case '\t':
+            out.append("\\t");
+            break;
+        default:
+            if (quint8(c) < 0x20) {
+                out.append("\\u00");
+                out.append(kHexDigits[quint8(c) >> 4]);
+                out.append(kHexDigits[quint8(c) & 15]);
+            } else {
+                out.append(c);
+            }
+        }
+    }
+    out.append('"');
+}
+
+} // namespace
+
+JsonLedgerWriter::JsonLedgerWriter(QIODevice *json, QIODevice *encrypted, const QAESKeySchedule &schedule,
+                                   const QByteArray &iv)
+    : m_json(json)
+    , m_encrypted(encrypted)
+    , m_encryptor(schedule, iv)
+{
+    m_text.reserve(kFlushSize + 1024);
+    m_text.append('[');
+}
+
+bool JsonLedgerWriter::append(QByteArrayView article, int quantity, qint64 timestamp, QByteArrayView hash)
+{
+    if (!m_errorString.isEmpty()) {
+        return false;
+    }
+    // QJsonObject keeps its keys sorted, so this is the order the GUI export uses.
+    m_text.append(m_count == 0 ? "\n    {\n        \"article\": " : ",\n    {\n        \"article\": ");
+    appendJsonString(m_text, article);
+    m_text.append(",\n        \"hash\": ");
+    appendJsonString(m_text, hash);
+    m_text.append(",\n        \"quantity\": ");
+    m_text.append(QByteArray::number(quantity));
+    m_text.append(",\n        \"timestamp\": ");
+    m_text.append(QByteArray::number(timestamp));
+    m_text.append("\n    }");
+    ++m_count;
+    return m_text.size() < kFlushSize || flush(false);
+}
+
+bool JsonLedgerWriter::finish()
+{
+    if (!m_errorString.isEmpty()) {
+        return false;
+    }
+    m_text.append("\n]\n");
+    return flush(true);
+}
+
+bool JsonLedgerWriter::write(QIODevice *device, const QByteArray &data, qint64 &written)
+{
+    if (device->write(data) != data.size()) {
+        m_errorString = device->errorString();
+        return false;
+    }
+    written += data.size();
+    return true;
+}
+
+bool JsonLedgerWriter::flush(bool last)
+{
+    if (m_json && !write(m_json, m_text, m_jsonSize)) {
+        return false;
+    }
+    if (m_encrypted) {
+        m_cipher.resize(0);
+        m_base64.resize(0);
+        if (!m_encryptor.feed(m_text, m_cipher) || (last && !m_encryptor.finish(m_cipher))) {
+            m_errorString = QObject::tr("ошибка шифрования AES-256");
+            return false;
+        }
+        m_encoder.feed(m_cipher, m_base64);
+        if (last) {
+            m_encoder.finish(m_base64);
+        }
+        if (!write(m_encrypted, m_base64, m_encryptedSize)) {
+            return false;
+        }
+    }
+    m_text.resize(0);
+    return true;
+}
+
+} // namespace ledger
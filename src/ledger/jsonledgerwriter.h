@@ -0,0 +1,52 @@
+#pragma once
+
+#include "crypto/aesstream.h"
+#include "crypto/base64.h"
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+
+class QIODevice;
+
+namespace ledger {
+
+/// Writes records as a JSON array as they come, in the same layout as
+/// QJsonDocument::Indented, so memory use does not depend on the ledger size. The
+/// same text can go at once to a second device AES-CBC encrypted and Base64 encoded,
+/// which is what .enc files hold.
+class JsonLedgerWriter
+{
+public:
+    /// Either device may be null. @p schedule is only used for @p encrypted and must
+    /// outlive the writer.
+    JsonLedgerWriter(QIODevice *json, QIODevice *encrypted, const QAESKeySchedule &schedule, const QByteArray &iv);
+
+    /// Text fields are UTF-8.
+    bool append(QByteArrayView article, int quantity, qint64 timestamp, QByteArrayView hash);
+    /// Closes the array and writes out everything still buffered.
+    bool finish();
+
+    QString errorString() const { return m_errorString; }
+    qint64 recordCount() const { return m_count; }
+    qint64 jsonSize() const { return m_jsonSize; }
+    qint64 encryptedSize() const { return m_encryptedSize; }
+
+private:
+    bool flush(bool last);
+    bool write(QIODevice *device, const QByteArray &data, qint64 &written);
+
+    QIODevice *m_json = nullptr;
+    QIODevice *m_encrypted = nullptr;
+    crypto::CbcStreamEncryptor m_encryptor;
+    crypto::Base64Encoder m_encoder;
+    QByteArray m_text;
+    QByteArray m_cipher;
+    QByteArray m_base64;
+    qint64 m_count = 0;
+    qint64 m_jsonSize = 0;
+    qint64 m_encryptedSize = 0;
+    QString m_errorString;
+};
+
+} // namespace ledger
@@ -0,0 +1,225 @@
+#include "jsonrecordstream.h"
+
+#include "crypto/aesstream.h"
+#include "crypto/base64.h"
+#include "perf/trace.h"
+#include "transactionparser.h"
+
+#include <QFileDevice>
+#include <QIODevice>
+#include <QObject>
+
+#include <optional>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+namespace ledger {
+namespace {
+
+// Big enough to amortise read() calls, small enough that peak memory does not
+// depend on the ledger size.
+constexpr qint64 kReadChunk = 256 * 1024;
+
+inline bool isJsonWhitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Detects the container format from the first significant byte, then routes
+// input either straight to the parser or through Base64 and CBC first.
+class RecordPipeline
+{
+public:
+    RecordPipeline(const QAESKeySchedule &schedule, const QByteArray &iv, Ledger &ledger)
+        : m_parser(ledger)
+    {
+        m_decryptor.emplace(schedule, iv);
+    }
+
+    /// Plain JSON only, continuing after @p point.
+    RecordPipeline(const TransactionParser::ResumePoint &point, Ledger &ledger)
+        : m_parser(ledger)
+    {
+        m_parser.resume(point);
+        m_formatKnown = true;
+    }
+
+    bool feed(QByteArrayView input)
+    {
+        if (m_result.error != StreamError::None) {
+            return false;
+        }
+        if (!m_formatKnown) {
+            // The generator writes either a bare JSON array or Base64 text; '[' is not
+            // in the Base64 alphabet, so the first significant byte tells them apart.
+            for (const char c : input) {
+                if (!isJsonWhitespace(c)) {
+                    m_formatKnown = true;
+                    m_result.encrypted = c != '[';
+                    break;
+                }
+            }
+        }
+
+        if (!m_result.encrypted) {
+            return parse(input);
+        }
+        return decryptChunk(input);
+    }
+
+    bool finish()
+    {
+        if (m_result.error != StreamError::None) {
+            return false;
+        }
+        if (!m_formatKnown) {
+            return fail(StreamError::Decrypt);
+        }
+        if (m_result.encrypted) {
+            m_cipher.resize(0);
+            m_plain.resize(0);
+            if (!perf::measure(perf::Stage::Base64, 0, [&] { return m_base64.finish(m_cipher); })
+                || !perf::measure(perf::Stage::Decrypt, m_cipher.size(),
+                                  [&] { return m_decryptor->feed(m_cipher, m_plain); })
+                || !perf::measure(perf::Stage::Unpad, 0, [&] { return m_decryptor->finish(m_plain); })) {
+                return fail(StreamError::Decrypt);
+            }
+            if (!parse(m_plain)) {
+                return false;
+            }
+        }
+        if (!perf::measure(perf::Stage::Parse, 0, [&] { return m_parser.finish(); })) {
+            return failJson();
+        }
+        m_result.resumePoint = m_parser.resumePoint();
+        return true;
+    }
+
+    bool fail(StreamError error, const QString &message = QString())
+    {
+        m_result.error = error;
+        m_result.errorString = message;
+        return false;
+    }
+
+    const StreamResult &result() const { return m_result; }
+
+private:
+    bool failJson()
+    {
+        m_result.errorOffset = m_parser.errorOffset();
+        return fail(StreamError::Json, m_parser.errorString());
+    }
+
+    bool decryptChunk(QByteArrayView input)
+    {
+        // resize(0) keeps the capacity, so the stage buffers are allocated once.
+        m_cipher.resize(0);
+        m_plain.resize(0);
+        if (!perf::measure(perf::Stage::Base64, input.size(), [&] { return m_base64.feed(input, m_cipher); })
+            || !perf::measure(perf::Stage::Decrypt, m_cipher.size(),
+                              [&] { return m_decryptor->feed(m_cipher, m_plain); })) {
+            return fail(StreamError::Decrypt);
+        }
+        return parse(m_plain);
+    }
+
+    bool parse(QByteArrayView input)
+    {
+        return perf::measure(perf::Stage::Parse, input.size(), [&] { return m_parser.feed(input); }) || failJson();
+    }
+
+    TransactionParser m_parser;
+    crypto::Base64Decoder m_base64;
+    std::optional<crypto::CbcStreamDecryptor> m_decryptor;
+    QByteArray m_cipher;
+    QByteArray m_plain;
+    bool m_formatKnown = false;
+    StreamResult m_result;
+};
+
+StreamResult pumpDevice(QIODevice &device, RecordPipeline &pipeline, const ProgressCallback &progress,
+                        FileAccess access)
+{
+    // Files are mapped instead of read: plain JSON is then split straight out of
+    // the page cache with no private copy, and ciphertext skips one memcpy.
+    auto *file = access == FileAccess::Map ? qobject_cast<QFileDevice *>(&device) : nullptr;
+    const qint64 mappedSize = file ? file->size() - file->pos() : 0;
+    if (mappedSize > 0) {
+        // Only the mapping itself counts as reading here; the page faults it defers
+        // land in whichever stage touches the bytes first.
+        uchar *mapped =
+            perf::measure(perf::Stage::Read, mappedSize, [&] { return file->map(file->pos(), mappedSize); });
+        if (mapped) {
+#ifdef Q_OS_UNIX
+            posix_madvise(mapped, size_t(mappedSize), POSIX_MADV_SEQUENTIAL);
+#endif
+            // Fed in read-sized slices so the stage buffers stay small and progress
+            // is reported at the same rate as for the read path.
+            const QByteArrayView input(reinterpret_cast<const char *>(mapped), mappedSize);
+            bool ok = true;
+            for (qint64 offset = 0; ok && offset < mappedSize; offset += kReadChunk) {
+                const qint64 size = qMin(kReadChunk, mappedSize - offset);
+                ok = pipeline.feed(input.mid(offset, size));
+                if (ok && progress && !progress(offset + size, mappedSize)) {
+                    ok = pipeline.fail(StreamError::Canceled);
+                }
+            }
+            if (ok) {
+                pipeline.finish();
+            }
+            file->unmap(mapped);
+            return pipeline.result();
+        }
+    }
+
+    const qint64 total = device.isSequential() ? -1 : device.size() - device.pos();
+    qint64 done = 0;
+    QByteArray chunk(kReadChunk, Qt::Uninitialized);
+    for (;;) {
+        const qint64 expected = total < 0 ? kReadChunk : qMin(kReadChunk, total - done);
+        const qint64 read =
+            perf::measure(perf::Stage::Read, expected, [&] { return device.read(chunk.data(), kReadChunk); });
+        if (read < 0) {
+            pipeline.fail(StreamError::Read, device.errorString());
+            return pipeline.result();
+        }
+        if (read == 0) {
+            break;
+        }
+        if (!pipeline.feed(QByteArrayView(chunk.constData(), read))) {
+            return pipeline.result();
+        }
+        done += read;
+        if (progress && !progress(done, total)) {
+            pipeline.fail(StreamError::Canceled);
+            return pipeline.result();
+        }
+    }
+    pipeline.finish();
+    return pipeline.result();
+}
+
+} // namespace
+
+StreamResult readJsonRecords(QIODevice &device, const QAESKeySchedule &schedule, const QByteArray &iv,
+                             Ledger &ledger, const ProgressCallback &progress, FileAccess access)
+{
+    RecordPipeline pipeline(schedule, iv, ledger);
+    return pumpDevice(device, pipeline, progress, access);
+}
+
+StreamResult readJsonTail(QIODevice &device, const TransactionParser::ResumePoint &point, Ledger &ledger,
+                          const ProgressCallback &progress, FileAccess access)
+{
+    RecordPipeline pipeline(point, ledger);
+    if (!device.seek(point.offset)) {
+        pipeline.fail(StreamError::Read, device.errorString());
+        return pipeline.result();
+    }
+    return pumpDevice(device, pipeline, progress, access);
+}
+
+} // namespace ledger
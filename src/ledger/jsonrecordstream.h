@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ledger.h"
+#include "transactionparser.h"
+
+#include <QByteArray>
+#include <QString>
+
+#include <functional>
+
+class QAESKeySchedule;
+class QIODevice;
+
+namespace ledger {
+
+enum class StreamError {
+    None,
+    Read,
+    Decrypt,
+    Json,
+    /// Damaged binary ledger.
+    Format,
+    Canceled
+};
+
+/// How a file is brought in. Other devices are always read in chunks.
+enum class FileAccess {
+    /// Memory-mapped and parsed in place.
+    Map,
+    /// Copied out with read(). For files another process may truncate or rewrite
+    /// while they are read: a mapped page past the new end faults with SIGBUS, where
+    /// read() just returns fewer bytes.
+    Read
+};
+
+/// Called after each input chunk with the bytes consumed so far and the input size
+/// (-1 if unknown). Returning false stops reading with StreamError::Canceled.
+using ProgressCallback = std::function<bool(qint64 done, qint64 total)>;
+
+struct StreamResult {
+    StreamError error = StreamError::None;
+    bool encrypted = false;
+    QString errorString;
+    /// Byte offset of a JSON error within the (decrypted) document, -1 otherwise.
+    qint64 errorOffset = -1;
+    /// Where a plain JSON ledger can be continued with readJsonTail() once the file
+    /// grows; invalid for encrypted input.
+    TransactionParser::ResumePoint resumePoint;
+};
+
+/// Reads a ledger from @p device and appends its records to @p ledger. Files are
+/// memory-mapped and parsed in place unless @p access says otherwise, other devices
+/// are read in fixed-size chunks.
+/// A plain JSON array goes straight to the parser; anything else is taken as Base64
+/// of AES-CBC/PKCS#7 ciphertext and runs through incremental Base64 decode and CBC
+/// decrypt first.
+StreamResult readJsonRecords(QIODevice &device, const QAESKeySchedule &schedule, const QByteArray &iv,
+                             Ledger &ledger, const ProgressCallback &progress = ProgressCallback(),
+                             FileAccess access = FileAccess::Map);
+
+/// Appends the records a plain JSON ledger gained after @p point, which came from
+/// an earlier read of the same file. Only the bytes from point.offset on are read.
+StreamResult readJsonTail(QIODevice &device, const TransactionParser::ResumePoint &point, Ledger &ledger,
+                          const ProgressCallback &progress = ProgressCallback(), FileAccess access = FileAccess::Map);
+
+} // namespace ledger
@@ -0,0 +1,396 @@
+#include "ledger.h"
+
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <cstring>
+
+namespace ledger {
+namespace {
+
+// Below this size spinning up the thread pool costs more than hashing itself.
+constexpr qsizetype kParallelValidationThreshold = 4096;
+constexpr qsizetype kMinValidationChunk = 1024;
+// Records hashed per md5Batch call; a multiple of the widest SIMD lane count.
+constexpr qsizetype kHashBatch = 64;
+// A u64 holds any 19-digit number.
+constexpr int kMaxArticleWidth = 19;
+constexpr int kDigestTextSize = 24;
+
+constexpr char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+struct IndexRange {
+    qsizetype begin = 0;
+    qsizetype end = 0;
+};
+
+bool isDigits(QByteArrayView text)
+{
+    for (const char c : text) {
+        if (c < '0' || c > '9')
+            return false;
+    }
+    return true;
+}
+
+int base64Value(char c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == '+')
+        return 62;
+    if (c == '/')
+        return 63;
+    return -1;
+}
+
+// Accepts only the exact text QByteArray::toBase64() gives for 16 bytes, so that
+// encoding the digest again always reproduces the stored string.
+bool decodeDigest(QByteArrayView text, crypto::Md5Digest &digest)
+{
+    if (text.size() != kDigestTextSize || text[22] != '=' || text[23] != '=')
+        return false;
+    quint32 bits = 0;
+    int bitCount = 0;
+    int out = 0;
+    for (int i = 0; i < 22; ++i) {
+        const int value = base64Value(text[i]);
+        if (value < 0)
+            return false;
+        bits = (bits << 6) | quint32(value);
+        bitCount += 6;
+        if (bitCount >= 8) {
+            bitCount -= 8;
+            digest.bytes[out++] = quint8(bits >> bitCount);
+        }
+    }
+    // The four bits left over after 16 bytes must be zero.
+    return (bits & ((1u << bitCount) - 1)) == 0;
+}
+
+void encodeDigest(const crypto::Md5Digest &digest, char *text)
+{
+    const quint8 *bytes = digest.bytes.data();
+    for (int i = 0; i < 15; i += 3) {
+        const quint32 group = quint32(bytes[i]) << 16 | quint32(bytes[i + 1]) << 8 | bytes[i + 2];
+        *text++ = kBase64Alphabet[group >> 18];
+        *text++ = kBase64Alphabet[(group >> 12) & 63];
+        *text++ = kBase64Alphabet[(group >> 6) & 63];
+        *text++ = kBase64Alphabet[group & 63];
+    }
+    const quint32 last = quint32(bytes[15]) << 16;
+    *text++ = kBase64Alphabet[last >> 18];
+    *text++ = kBase64Alphabet[(last >> 12) & 63];
+    *text++ = '=';
+    *text = '=';
+}
+
+void formatArticleId(quint64 value, int width, char *digits)
+{
+    for (int i = width - 1; i >= 0; --i) {
+        digits[i] = char('0' + value % 10);
+        value /= 10;
+    }
+}
+
+// Same text as QByteArray::number(), without the temporary.
+void appendDecimal(QByteArray &out, qint64 value)
+{
+    char digits[20];
+    int size = 0;
+    quint64 magnitude = value < 0 ? 0 - quint64(value) : quint64(value);
+    do {
+        digits[size++] = char('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0)
+        out.append('-');
+    while (size)
+        out.append(digits[--size]);
+}
+
+} // namespace
+
+void Ledger::appendArticle(QByteArrayView article)
+{
+    const qsizetype index = m_articleIds.size();
+    if (m_articleWidth == 0 && !article.isEmpty() && article.size() <= kMaxArticleWidth && isDigits(article))
+        m_articleWidth = int(article.size());
+
+    if (article.size() == m_articleWidth && m_articleWidth > 0 && isDigits(article)) {
+        quint64 id = 0;
+        for (const char c : article)
+            id = id * 10 + quint64(c - '0');
+        m_articleIds.push_back(id);
+    } else {
+        m_articleIds.push_back(0);
+        m_articleText.insert(index, QByteArray(article.data(), article.size()));
+    }
+}
+
+void Ledger::append(QByteArrayView article, int quantity, qint64 timestamp, QByteArrayView storedHash)
+{
+    crypto::Md5Digest digest;
+    if (!decodeDigest(storedHash, digest)) {
+        digest = crypto::Md5Digest();
+        m_hashText.insert(m_storedHashes.size(), QByteArray(storedHash.data(), storedHash.size()));
+    }
+    append(article, quantity, timestamp, digest);
+}
+
+void Ledger::append(QByteArrayView article, int quantity, qint64 timestamp, const crypto::Md5Digest &storedHash)
+{
+    appendArticle(article);
+    m_quantities.push_back(quantity);
+    m_timestamps.push_back(timestamp);
+    m_storedHashes.push_back(storedHash);
+}
+
+void Ledger::append(const Transaction &transaction)
+{
+    append(transaction.article.toUtf8(), transaction.quantity, transaction.shipmentTimestamp,
+           transaction.storedHash.toUtf8());
+}
+
+void Ledger::append(const Ledger &other)
+{
+    const qsizetype offset = size();
+    const bool keepValidation = validatedCount() == offset && other.validatedCount() == other.size();
+    if (offset == 0)
+        m_articleWidth = other.m_articleWidth;
+
+    if (other.m_articleWidth == m_articleWidth) {
+        m_articleIds.append(other.m_articleIds);
+        m_quantities.append(other.m_quantities);
+        m_timestamps.append(other.m_timestamps);
+        m_storedHashes.append(other.m_storedHashes);
+        for (auto it = other.m_articleText.constBegin(); it != other.m_articleText.constEnd(); ++it)
+            m_articleText.insert(offset + it.key(), it.value());
+        for (auto it = other.m_hashText.constBegin(); it != other.m_hashText.constEnd(); ++it)
+            m_hashText.insert(offset + it.key(), it.value());
+    } else {
+        // Packed IDs are only comparable at the same width; repack through text.
+        reserve(offset + other.size());
+        for (qsizetype i = 0; i < other.size(); ++i) {
+            const QByteArray article = other.article(i).toUtf8();
+            if (const crypto::Md5Digest *digest = other.storedDigest(i)) {
+                append(article, other.quantity(i), other.timestamp(i), *digest);
+            } else {
+                append(article, other.quantity(i), other.timestamp(i), other.m_hashText.value(i));
+            }
+        }
+    }
+
+    if (keepValidation) {
+        m_calculatedHashes.append(other.m_calculatedHashes);
+        if (m_firstInvalid < 0 && other.m_firstInvalid >= 0)
+            m_firstInvalid = offset + other.m_firstInvalid;
+    }
+}
+
+Ledger Ledger::mid(qsizetype from, qsizetype count) const
+{
+    Ledger part;
+    part.m_articleWidth = m_articleWidth;
+    part.m_articleIds = m_articleIds.mid(from, count);
+    part.m_quantities = m_quantities.mid(from, count);
+    part.m_timestamps = m_timestamps.mid(from, count);
+    part.m_storedHashes = m_storedHashes.mid(from, count);
+    if (from < validatedCount())
+        part.m_calculatedHashes = m_calculatedHashes.mid(from, qMin(count, validatedCount() - from));
+    for (qsizetype i = 0; i < count && !(m_articleText.isEmpty() && m_hashText.isEmpty()); ++i) {
+        const auto article = m_articleText.constFind(from + i);
+        if (article != m_articleText.constEnd())
+            part.m_articleText.insert(i, *article);
+        const auto hash = m_hashText.constFind(from + i);
+        if (hash != m_hashText.constEnd())
+            part.m_hashText.insert(i, *hash);
+    }
+    if (m_firstInvalid >= 0 && m_firstInvalid < from + count)
+        part.m_firstInvalid = qMax<qsizetype>(0, m_firstInvalid - from);
+    return part;
+}
+
+void Ledger::reserve(qsizetype count)
+{
+    m_articleIds.reserve(count);
+    m_quantities.reserve(count);
+    m_timestamps.reserve(count);
+    m_storedHashes.reserve(count);
+}
+
+void Ledger::clear()
+{
+    *this = Ledger();
+}
+
+QString Ledger::article(qsizetype index) const
+{
+    const auto text = m_articleText.constFind(index);
+    if (text != m_articleText.constEnd())
+        return QString::fromUtf8(*text);
+    char digits[kMaxArticleWidth];
+    formatArticleId(m_articleIds.at(index), m_articleWidth, digits);
+    return QString::fromLatin1(digits, m_articleWidth);
+}
+
+const crypto::Md5Digest *Ledger::storedDigest(qsizetype index) const
+{
+    return m_hashText.contains(index) ? nullptr : &m_storedHashes.at(index);
+}
+
+QString Ledger::storedHash(qsizetype index) const
+{
+    const auto text = m_hashText.constFind(index);
+    if (text != m_hashText.constEnd())
+        return QString::fromUtf8(*text);
+    char encoded[kDigestTextSize];
+    encodeDigest(m_storedHashes.at(index), encoded);
+    return QString::fromLatin1(encoded, kDigestTextSize);
+}
+
+QString Ledger::calculatedHash(qsizetype index) const
+{
+    char encoded[kDigestTextSize];
+    encodeDigest(m_calculatedHashes.at(index), encoded);
+    return QString::fromLatin1(encoded, kDigestTextSize);
+}
+
+Transaction Ledger::transaction(qsizetype index) const
+{
+    Transaction transaction;
+    transaction.article = article(index);
+    transaction.quantity = quantity(index);
+    transaction.shipmentTimestamp = timestamp(index);
+    transaction.storedHash = storedHash(index);
+    return transaction;
+}
+
+void Ledger::appendPayload(qsizetype index, QByteArray &payload) const
+{
+    const auto text = m_articleText.constFind(index);
+    if (text != m_articleText.constEnd()) {
+        payload.append(*text);
+    } else {
+        char digits[kMaxArticleWidth];
+        formatArticleId(m_articleIds.at(index), m_articleWidth, digits);
+        payload.append(digits, m_articleWidth);
+    }
+    appendDecimal(payload, m_quantities.at(index));
+    appendDecimal(payload, m_timestamps.at(index));
+    if (index == 0)
+        return;
+
+    const auto previous = m_hashText.constFind(index - 1);
+    if (previous != m_hashText.constEnd()) {
+        payload.append(*previous);
+    } else {
+        char encoded[kDigestTextSize];
+        encodeDigest(m_storedHashes.at(index - 1), encoded);
+        payload.append(encoded, kDigestTextSize);
+    }
+}
+
+void Ledger::validate()
+{
+    const qsizetype from = m_calculatedHashes.size();
+    const qsizetype count = size();
+    if (from == count)
+        return;
+    m_calculatedHashes.resize(count);
+    // Detach once up front so worker threads only touch plain memory.
+    crypto::Md5Digest *calculated = m_calculatedHashes.data();
+
+    const auto hashRange = [this, calculated](const IndexRange &range) {
+        QByteArray payloads[kHashBatch];
+        QByteArrayView views[kHashBatch];
+
+        for (qsizetype begin = range.begin; begin < range.end; begin += kHashBatch) {
+            const qsizetype batch = qMin(kHashBatch, range.end - begin);
+            for (qsizetype j = 0; j < batch; ++j) {
+                // resize(0) keeps the capacity, so each buffer is allocated once.
+                payloads[j].resize(0);
+                appendPayload(begin + j, payloads[j]);
+                views[j] = payloads[j];
+            }
+            crypto::md5Batch(views, calculated + begin, batch);
+        }
+    };
+
+    if (count - from < kParallelValidationThreshold) {
+        hashRange(IndexRange{from, count});
+    } else {
+        // A few chunks per core keeps the pool balanced when some records are longer.
+        const qsizetype workers = qMax(1, QThread::idealThreadCount());
+        const qsizetype chunkSize = qMax(kMinValidationChunk, (count - from + workers * 4 - 1) / (workers * 4));
+
+        QVector<IndexRange> ranges;
+        ranges.reserve((count - from + chunkSize - 1) / chunkSize);
+        for (qsizetype begin = from; begin < count; begin += chunkSize) {
+            ranges.push_back(IndexRange{begin, qMin(begin + chunkSize, count)});
+        }
+        QtConcurrent::blockingMap(ranges, hashRange);
+    }
+
+    scanChain(from);
+}
+
+void Ledger::restoreValidation(qsizetype count, const QVector<QPair<qsizetype, crypto::Md5Digest>> &mismatches)
+{
+    const qsizetype from = m_calculatedHashes.size();
+    if (count <= from)
+        return;
+    m_calculatedHashes.append(m_storedHashes.mid(from, count - from));
+    for (const auto &mismatch : mismatches) {
+        if (mismatch.first >= from && mismatch.first < count)
+            m_calculatedHashes[mismatch.first] = mismatch.second;
+    }
+    scanChain(from);
+}
+
+quint64 Ledger::fingerprint(qsizetype from, qsizetype count, quint64 seed) const
+{
+    // Record `from` chains to the stored hash of the one before it.
+    const qsizetype first = qMax<qsizetype>(0, from - 1);
+    size_t hash = qHashMulti(size_t(seed), m_articleWidth, from, count);
+    hash = qHashBits(m_articleIds.constData() + from, size_t(count) * sizeof(quint64), hash);
+    hash = qHashBits(m_quantities.constData() + from, size_t(count) * sizeof(qint32), hash);
+    hash = qHashBits(m_timestamps.constData() + from, size_t(count) * sizeof(qint64), hash);
+    hash = qHashBits(m_storedHashes.constData() + first, size_t(from + count - first) * sizeof(crypto::Md5Digest),
+                     hash);
+
+    // QHash order is not stable, so the side values are combined commutatively.
+    size_t sideValues = 0;
+    for (auto it = m_articleText.constBegin(); it != m_articleText.constEnd(); ++it) {
+        if (it.key() >= from && it.key() < from + count)
+            sideValues += qHashMulti(size_t(seed), 'a', it.key(), it.value());
+    }
+    for (auto it = m_hashText.constBegin(); it != m_hashText.constEnd(); ++it) {
+        if (it.key() >= first && it.key() < from + count)
+            sideValues += qHashMulti(size_t(seed), 'h', it.key(), it.value());
+    }
+    return quint64(qHashMulti(hash, sideValues));
+}
+
+void Ledger::scanChain(qsizetype from)
+{
+    // The only sequential part: once the chain breaks, everything after it is invalid.
+    if (m_firstInvalid >= 0)
+        return;
+    const qsizetype count = m_calculatedHashes.size();
+    const crypto::Md5Digest *stored = m_storedHashes.constData();
+    const crypto::Md5Digest *calculated = m_calculatedHashes.constData();
+    for (qsizetype i = from; i < count; ++i) {
+        // Non-canonical stored text can never equal the Base64 of a digest.
+        if (std::memcmp(&stored[i], &calculated[i], sizeof(crypto::Md5Digest)) != 0 || m_hashText.contains(i)) {
+            m_firstInvalid = i;
+            break;
+        }
+    }
+}
+
+} // namespace ledger
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "crypto/md5batch.h"
+#include "transaction.h"
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+namespace ledger {
+
+/// Column-wise store for a loaded ledger. Articles of the common digit width are
+/// packed into integers and hashes are kept as raw MD5 digests, so a record costs
+/// about 50 bytes in a few contiguous arrays. Values that do not pack (odd articles,
+/// hash text that is not canonical Base64 of 16 bytes) are kept verbatim on the side,
+/// so nothing is lost. Base64 and article text are only produced when asked for.
+class Ledger
+{
+public:
+    /// Text fields are UTF-8.
+    void append(QByteArrayView article, int quantity, qint64 timestamp, QByteArrayView storedHash);
+    void append(QByteArrayView article, int quantity, qint64 timestamp, const crypto::Md5Digest &storedHash);
+    void append(const Transaction &transaction);
+    /// Appends all records of @p other. Validation results are carried over when
+    /// both sides are fully validated, as happens for consecutive mid() slices.
+    void append(const Ledger &other);
+    /// Copy of @p count records starting at @p from, with their validation results.
+    Ledger mid(qsizetype from, qsizetype count) const;
+
+    void reserve(qsizetype count);
+    void clear();
+
+    qsizetype size() const { return m_quantities.size(); }
+    bool isEmpty() const { return m_quantities.isEmpty(); }
+
+    QString article(qsizetype index) const;
+    int quantity(qsizetype index) const { return m_quantities.at(index); }
+    qint64 timestamp(qsizetype index) const { return m_timestamps.at(index); }
+    QString storedHash(qsizetype index) const;
+    Transaction transaction(qsizetype index) const;
+
+    /// Digit count of packed articles, 0 until the first all-digit article arrives.
+    int articleWidth() const { return m_articleWidth; }
+    /// True if the article is stored as articleId() rather than as text.
+    bool hasPackedArticle(qsizetype index) const { return !m_articleText.contains(index); }
+    quint64 articleId(qsizetype index) const { return m_articleIds.at(index); }
+    /// Raw stored digest, or nullptr when the file held some other text.
+    const crypto::Md5Digest *storedDigest(qsizetype index) const;
+
+    /// Recomputes the chain for records appended since the last call. Each record
+    /// hashes its own fields plus the previous record's *stored* hash, so earlier
+    /// results never change when records are added.
+    void validate();
+    qsizetype validatedCount() const { return m_calculatedHashes.size(); }
+    /// Only meaningful for validated records.
+    QString calculatedHash(qsizetype index) const;
+    bool chainValid(qsizetype index) const { return m_firstInvalid < 0 || index < m_firstInvalid; }
+    /// Index of the first record whose hash does not match, -1 if the chain is intact.
+    qsizetype firstInvalid() const { return m_firstInvalid; }
+    const crypto::Md5Digest &calculatedDigest(qsizetype index) const { return m_calculatedHashes.at(index); }
+
+    /// Cheap non-cryptographic hash of everything validation reads for @p count
+    /// records from @p from, including the stored hash of the record before them.
+    quint64 fingerprint(qsizetype from, qsizetype count, quint64 seed) const;
+    /// Marks records up to @p count as validated without hashing them: each gets its
+    /// stored digest as calculated hash, except those listed in @p mismatches.
+    void restoreValidation(qsizetype count, const QVector<QPair<qsizetype, crypto::Md5Digest>> &mismatches);
+
+private:
+    void appendArticle(QByteArrayView article);
+    void appendPayload(qsizetype index, QByteArray &payload) const;
+    void scanChain(qsizetype from);
+
+    int m_articleWidth = 0;
+    QVector<quint64> m_articleIds;
+    QVector<qint32> m_quantities;
+    QVector<qint64> m_timestamps;
+    QVector<crypto::Md5Digest> m_storedHashes;
+    QVector<crypto::Md5Digest> m_calculatedHashes;
+    // Rare values that do not fit the packed columns, keyed by record index.
+    QHash<qsizetype, QByteArray> m_articleText;
+    QHash<qsizetype, QByteArray> m_hashText;
+    qsizetype m_firstInvalid = -1;
+};
+
+} // namespace ledger
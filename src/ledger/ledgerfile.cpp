@@ -0,0 +1,54 @@
+#include "ledgerfile.h"
+
+#include "binaryledger.h"
+#include "perf/trace.h"
+
+#include <QFile>
+
+namespace ledger {
+namespace {
+
+// Records copied out of a mapped .txl between progress reports.
+constexpr qsizetype kBinaryBatch = 16384;
+
+} // namespace
+
+StreamResult readLedgerFile(QFile &file, const QAESKeySchedule &schedule, const QByteArray &iv, Ledger &ledger,
+                            const ProgressCallback &progress, FileAccess access)
+{
+    if (!BinaryLedgerReader::hasMagic(file.peek(sizeof(binary::kMagic)))) {
+        return readJsonRecords(file, schedule, iv, ledger, progress, access);
+    }
+
+    StreamResult result;
+    BinaryLedgerReader reader;
+    // With FileAccess::Read the reader points into this copy.
+    QByteArray image;
+    const bool opened = perf::measure(perf::Stage::Read, file.size(), [&] {
+        if (access == FileAccess::Map) {
+            return reader.map(file);
+        }
+        image = file.readAll();
+        return reader.open(image);
+    });
+    if (!opened) {
+        result.error = StreamError::Format;
+        result.errorString = reader.errorString();
+        return result;
+    }
+    ledger.reserve(ledger.size() + reader.size());
+    for (qsizetype first = 0; first < reader.size(); first += kBinaryBatch) {
+        {
+            // Records have no fixed size on disk, so the batch is charged its share of the file.
+            PERF_SCOPE(perf::Stage::Parse, file.size() * qMin(kBinaryBatch, reader.size() - first) / reader.size());
+            reader.appendTo(ledger, first, kBinaryBatch);
+        }
+        if (progress && !progress(qMin(first + kBinaryBatch, reader.size()), reader.size())) {
+            result.error = StreamError::Canceled;
+            return result;
+        }
+    }
+    return result;
+}
+
+} // namespace ledger
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "jsonrecordstream.h"
+
+class QFile;
+
+namespace ledger {
+
+/// Reads any ledger file the viewer opens and appends its records to @p ledger: a
+/// binary .txl is recognised by its magic, anything else goes to readJsonRecords().
+/// A damaged .txl is reported as StreamError::Format; its progress counts records
+/// rather than bytes. With FileAccess::Read a .txl is read into memory instead of
+/// being mapped.
+StreamResult readLedgerFile(QFile &file, const QAESKeySchedule &schedule, const QByteArray &iv, Ledger &ledger,
+                            const ProgressCallback &progress = ProgressCallback(),
+                            FileAccess access = FileAccess::Map);
+
+} // namespace ledger
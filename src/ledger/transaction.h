@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+namespace ledger {
+
+/// One shipment record as stored in a ledger file. Loaded ledgers are kept in
+/// ledger::Ledger; this form is for building and editing small record lists.
+struct Transaction {
+    QString article;
+    int quantity = 0;
+    qint64 shipmentTimestamp = 0;
+    QString storedHash;
+};
+
+} // namespace ledger
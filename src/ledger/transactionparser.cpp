@@ -0,0 +1,600 @@
+#include "transactionparser.h"
+
+#include <QObject>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace ledger {
+namespace {
+
+// Same nesting limit as QJsonDocument.
+constexpr int kMaxDepth = 1024;
+// Growth step when completing an element that straddles two chunks.
+constexpr qsizetype kCarryStep = 4096;
+
+enum class Field {
+    Unknown,
+    Article,
+    Quantity,
+    Timestamp,
+    Hash
+};
+
+inline bool isJsonWhitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline const char *skipWhitespace(const char *p, const char *end)
+{
+    while (p < end && isJsonWhitespace(*p))
+        ++p;
+    return p;
+}
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+Field fieldForKey(QByteArrayView key)
+{
+    switch (key.size()) {
+    case 4:
+        return std::memcmp(key.data(), "hash", 4) == 0 ? Field::Hash : Field::Unknown;
+    case 7:
+        return std::memcmp(key.data(), "article", 7) == 0 ? Field::Article : Field::Unknown;
+    case 8:
+        return std::memcmp(key.data(), "quantity", 8) == 0 ? Field::Quantity : Field::Unknown;
+    case 9:
+        return std::memcmp(key.data(), "timestamp", 9) == 0 ? Field::Timestamp : Field::Unknown;
+    default:
+        return Field::Unknown;
+    }
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+void appendUtf8(QByteArray &out, char32_t code)
+{
+    if (code < 0x80) {
+        out.append(char(code));
+    } else if (code < 0x800) {
+        out.append(char(0xc0 | (code >> 6)));
+        out.append(char(0x80 | (code & 0x3f)));
+    } else if (code < 0x10000) {
+        out.append(char(0xe0 | (code >> 12)));
+        out.append(char(0x80 | ((code >> 6) & 0x3f)));
+        out.append(char(0x80 | (code & 0x3f)));
+    } else {
+        out.append(char(0xf0 | (code >> 18)));
+        out.append(char(0x80 | ((code >> 12) & 0x3f)));
+        out.append(char(0x80 | ((code >> 6) & 0x3f)));
+        out.append(char(0x80 | (code & 0x3f)));
+    }
+}
+
+// Integer text without sign, fraction or exponent, as QByteArray::toLongLong would
+// read a string-typed timestamp; 0 when it does not fit.
+qint64 parseIntegerText(QByteArrayView text)
+{
+    bool ok = false;
+    const qint64 value = QByteArray::fromRawData(text.data(), text.size()).trimmed().toLongLong(&ok);
+    return ok ? value : 0;
+}
+
+} // namespace
+
+TransactionParser::TransactionParser(Ledger &ledger)
+    : m_ledger(ledger)
+{
+}
+
+TransactionParser::Status TransactionParser::error(const char *at, const QString &message)
+{
+    m_errorOffset = m_bufferOffset + (at - m_bufferBegin);
+    m_errorString = QObject::tr("смещение %1: %2").arg(m_errorOffset).arg(message);
+    return Status::Error;
+}
+
+TransactionParser::Status TransactionParser::parseString(const char *&p, const char *end, QByteArrayView &utf8)
+{
+    // p is at the opening quote.
+    const char *start = ++p;
+    while (p < end) {
+        const char c = *p;
+        if (c == '"') {
+            utf8 = QByteArrayView(start, p - start);
+            ++p;
+            return Status::Ok;
+        }
+        if (c == '\\')
+            break;
+        if (quint8(c) < 0x20)
+            return error(p, QObject::tr("управляющий символ в строке"));
+        ++p;
+    }
+    if (p == end)
+        return Status::Incomplete;
+
+    // Escapes present: decode the rest into the scratch buffer.
+    m_scratch.resize(0);
+    m_scratch.append(start, p - start);
+    while (p < end) {
+        const char c = *p;
+        if (c == '"') {
+            utf8 = QByteArrayView(m_scratch.constData(), m_scratch.size());
+            ++p;
+            return Status::Ok;
+        }
+        if (quint8(c) < 0x20)
+            return error(p, QObject::tr("управляющий символ в строке"));
+        if (c != '\\') {
+            m_scratch.append(c);
+            ++p;
+            continue;
+        }
+
+        if (end - p < 2)
+            return Status::Incomplete;
+        const char escape = p[1];
+        switch (escape) {
+        case '"': m_scratch.append('"'); break;
+        case '\\': m_scratch.append('\\'); break;
+        case '/': m_scratch.append('/'); break;
+        case 'b': m_scratch.append('\b'); break;
+        case 'f': m_scratch.append('\f'); break;
+        case 'n': m_scratch.append('\n'); break;
+        case 'r': m_scratch.append('\r'); break;
+        case 't': m_scratch.append('\t'); break;
+        case 'u': {
+            auto readCodeUnit = [&](const char *at, char32_t &unit) -> Status {
+                if (end - at < 6)
+                    return Status::Incomplete;
+                unit = 0;
+                for (int i = 2; i < 6; ++i) {
+                    const int digit = hexValue(at[i]);
+                    if (digit < 0)
+                        return error(at + i, QObject::tr("некорректная escape-последовательность"));
+                    unit = (unit << 4) | char32_t(digit);
+                }
+                return Status::Ok;
+            };
+            char32_t unit = 0;
+            const Status status = readCodeUnit(p, unit);
+            if (status != Status::Ok)
+                return status;
+            if (unit >= 0xd800 && unit < 0xdc00) {
+                // A high surrogate must be followed by a low one; a lone half becomes U+FFFD.
+                if (end - p < 8)
+                    return Status::Incomplete;
+                char32_t low = 0;
+                if (p[6] == '\\' && p[7] == 'u') {
+                    const Status lowStatus = readCodeUnit(p + 6, low);
+                    if (lowStatus != Status::Ok)
+                        return lowStatus;
+                }
+                if (low >= 0xdc00 && low < 0xe000) {
+                    appendUtf8(m_scratch, 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00));
+                    p += 6;
+                } else {
+                    appendUtf8(m_scratch, 0xfffd);
+                }
+            } else if (unit >= 0xdc00 && unit < 0xe000) {
+                appendUtf8(m_scratch, 0xfffd);
+            } else {
+                appendUtf8(m_scratch, unit);
+            }
+            p += 4;
+            break;
+        }
+        default:
+            return error(p, QObject::tr("некорректная escape-последовательность"));
+        }
+        p += 2;
+    }
+    return Status::Incomplete;
+}
+
+TransactionParser::Status TransactionParser::parseNumber(const char *&p, const char *end, Number &number)
+{
+    const char *start = p;
+    const bool negative = *p == '-';
+    if (negative)
+        ++p;
+    if (p == end)
+        return Status::Incomplete;
+
+    quint64 magnitude = 0;
+    bool overflow = false;
+    if (*p == '0') {
+        ++p;
+    } else if (isDigit(*p)) {
+        for (; p < end && isDigit(*p); ++p) {
+            const quint64 digit = quint64(*p - '0');
+            overflow = overflow || magnitude > (std::numeric_limits<quint64>::max() - digit) / 10;
+            magnitude = magnitude * 10 + digit;
+        }
+    } else {
+        return error(p, QObject::tr("некорректное число"));
+    }
+
+    bool integral = true;
+    if (p < end && *p == '.') {
+        integral = false;
+        if (++p == end)
+            return Status::Incomplete;
+        if (!isDigit(*p))
+            return error(p, QObject::tr("некорректное число"));
+        while (p < end && isDigit(*p))
+            ++p;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        integral = false;
+        if (++p < end && (*p == '+' || *p == '-'))
+            ++p;
+        if (p == end)
+            return Status::Incomplete;
+        if (!isDigit(*p))
+            return error(p, QObject::tr("некорректное число"));
+        while (p < end && isDigit(*p))
+            ++p;
+    }
+    // A number running into the end of the buffer may continue in the next chunk.
+    if (p == end)
+        return Status::Incomplete;
+
+    const quint64 limit = negative ? quint64(std::numeric_limits<qint64>::max()) + 1
+                                   : quint64(std::numeric_limits<qint64>::max());
+    number.isInteger = integral && !overflow && magnitude <= limit;
+    if (number.isInteger) {
+        number.integer = negative ? qint64(0 - magnitude) : qint64(magnitude);
+    } else {
+        number.real = QByteArray::fromRawData(start, p - start).toDouble();
+    }
+    return Status::Ok;
+}
+
+TransactionParser::Status TransactionParser::parseTimestamp(const char *&p, const char *end, qint64 &timestamp)
+{
+    // Mirrors QJsonValue::toVariant().toLongLong() for every JSON type.
+    if (*p == '"') {
+        QByteArrayView text;
+        const Status status = parseString(p, end, text);
+        if (status == Status::Ok)
+            timestamp = parseIntegerText(text);
+        return status;
+    }
+    if (*p == '-' || isDigit(*p)) {
+        Number number;
+        const Status status = parseNumber(p, end, number);
+        if (status != Status::Ok)
+            return status;
+        if (number.isInteger) {
+            timestamp = number.integer;
+        } else if (std::isfinite(number.real) && std::fabs(number.real) < 9.2e18) {
+            timestamp = qint64(std::llround(number.real));
+        } else {
+            timestamp = 0;
+        }
+        return Status::Ok;
+    }
+    timestamp = *p == 't' ? 1 : 0;
+    return skipValue(p, end, 1);
+}
+
+TransactionParser::Status TransactionParser::skipValue(const char *&p, const char *end, int depth)
+{
+    if (depth > kMaxDepth)
+        return error(p, QObject::tr("слишком глубокая вложенность"));
+
+    switch (*p) {
+    case '{':
+    case '[': {
+        const char close = *p == '{' ? '}' : ']';
+        const bool isObject = close == '}';
+        p = skipWhitespace(p + 1, end);
+        if (p == end)
+            return Status::Incomplete;
+        if (*p == close) {
+            ++p;
+            return Status::Ok;
+        }
+        for (;;) {
+            if (isObject) {
+                if (*p != '"')
+                    return error(p, QObject::tr("ожидалось имя поля"));
+                QByteArrayView key;
+                const Status keyStatus = parseString(p, end, key);
+                if (keyStatus != Status::Ok)
+                    return keyStatus;
+                p = skipWhitespace(p, end);
+                if (p == end)
+                    return Status::Incomplete;
+                if (*p != ':')
+                    return error(p, QObject::tr("ожидалось двоеточие"));
+                p = skipWhitespace(p + 1, end);
+                if (p == end)
+                    return Status::Incomplete;
+            }
+            const Status status = skipValue(p, end, depth + 1);
+            if (status != Status::Ok)
+                return status;
+            p = skipWhitespace(p, end);
+            if (p == end)
+                return Status::Incomplete;
+            if (*p == close) {
+                ++p;
+                return Status::Ok;
+            }
+            if (*p != ',')
+                return error(p, QObject::tr("ожидалась запятая"));
+            p = skipWhitespace(p + 1, end);
+            if (p == end)
+                return Status::Incomplete;
+        }
+    }
+    case '"': {
+        QByteArrayView ignored;
+        return parseString(p, end, ignored);
+    }
+    case 't':
+    case 'f':
+    case 'n': {
+        const char *literal = *p == 't' ? "true" : (*p == 'f' ? "false" : "null");
+        const qsizetype length = qsizetype(std::strlen(literal));
+        const qsizetype available = qMin<qsizetype>(length, end - p);
+        if (std::memcmp(p, literal, size_t(available)) != 0)
+            return error(p, QObject::tr("некорректное значение"));
+        if (available < length)
+            return Status::Incomplete;
+        p += length;
+        return Status::Ok;
+    }
+    default:
+        if (*p == '-' || isDigit(*p)) {
+            Number ignored;
+            return parseNumber(p, end, ignored);
+        }
+        return error(p, QObject::tr("некорректное значение"));
+    }
+}
+
+TransactionParser::Status TransactionParser::parseRecord(const char *&p, const char *end)
+{
+    // p is at the opening brace.
+    p = skipWhitespace(p + 1, end);
+    if (p == end)
+        return Status::Incomplete;
+    if (*p == '}') {
+        ++p;
+        return Status::Ok;
+    }
+
+    for (;;) {
+        if (*p != '"')
+            return error(p, QObject::tr("ожидалось имя поля"));
+        QByteArrayView key;
+        Status status = parseString(p, end, key);
+        if (status != Status::Ok)
+            return status;
+        const Field field = fieldForKey(key);
+
+        p = skipWhitespace(p, end);
+        if (p == end)
+            return Status::Incomplete;
+        if (*p != ':')
+            return error(p, QObject::tr("ожидалось двоеточие"));
+        p = skipWhitespace(p + 1, end);
+        if (p == end)
+            return Status::Incomplete;
+
+        switch (field) {
+        case Field::Article:
+        case Field::Hash: {
+            QByteArray &target = field == Field::Article ? m_record.article : m_record.hash;
+            target.resize(0);
+            if (*p == '"') {
+                QByteArrayView text;
+                status = parseString(p, end, text);
+                if (status == Status::Ok)
+                    target.append(text);
+            } else {
+                status = skipValue(p, end, 1);
+            }
+            break;
+        }
+        case Field::Quantity:
+            if (*p == '-' || isDigit(*p)) {
+                Number number;
+                status = parseNumber(p, end, number);
+                // QJsonValue::toInt(): integral values in int range, 0 otherwise.
+                const double value = number.isInteger ? double(number.integer) : number.real;
+                const bool fits = value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max()
+                                  && value == std::floor(value);
+                m_record.quantity = fits ? int(value) : 0;
+            } else {
+                m_record.quantity = 0;
+                status = skipValue(p, end, 1);
+            }
+            break;
+        case Field::Timestamp:
+            status = parseTimestamp(p, end, m_record.timestamp);
+            break;
+        case Field::Unknown:
+            status = skipValue(p, end, 1);
+            break;
+        }
+        if (status != Status::Ok)
+            return status;
+
+        p = skipWhitespace(p, end);
+        if (p == end)
+            return Status::Incomplete;
+        if (*p == '}') {
+            ++p;
+            return Status::Ok;
+        }
+        if (*p != ',')
+            return error(p, QObject::tr("ожидалась запятая"));
+        p = skipWhitespace(p + 1, end);
+        if (p == end)
+            return Status::Incomplete;
+    }
+}
+
+TransactionParser::Status TransactionParser::parseElement(const char *&p, const char *end)
+{
+    if (*p != '{')
+        return skipValue(p, end, 1);
+
+    m_record.article.resize(0);
+    m_record.hash.resize(0);
+    m_record.quantity = 0;
+    m_record.timestamp = 0;
+    const Status status = parseRecord(p, end);
+    if (status == Status::Ok)
+        m_ledger.append(m_record.article, m_record.quantity, m_record.timestamp, m_record.hash);
+    return status;
+}
+
+bool TransactionParser::parseBuffer(const char *p, const char *end)
+{
+    while (p < end) {
+        const char c = *p;
+        switch (m_state) {
+        case State::BeforeArray:
+            if (c == '[') {
+                m_state = State::BeforeFirstElement;
+                m_resumePoint = ResumePoint{m_bufferOffset + (p + 1 - m_bufferBegin), false};
+            } else if (!isJsonWhitespace(c)) {
+                error(p, QObject::tr("ожидался массив JSON"));
+                return false;
+            }
+            ++p;
+            break;
+        case State::BeforeFirstElement:
+        case State::BeforeElement: {
+            if (isJsonWhitespace(c)) {
+                ++p;
+                break;
+            }
+            if (c == ']' && m_state == State::BeforeFirstElement) {
+                m_state = State::Done;
+                ++p;
+                break;
+            }
+            const char *start = p;
+            const Status status = parseElement(p, end);
+            if (status == Status::Error)
+                return false;
+            if (status == Status::Incomplete) {
+                m_carryOffset = m_bufferOffset + (start - m_bufferBegin);
+                m_carry = QByteArray(start, end - start);
+                return true;
+            }
+            m_state = State::AfterElement;
+            m_resumePoint = ResumePoint{m_bufferOffset + (p - m_bufferBegin), true};
+            break;
+        }
+        case State::AfterElement:
+            if (c == ',') {
+                m_state = State::BeforeElement;
+            } else if (c == ']') {
+                m_state = State::Done;
+            } else if (!isJsonWhitespace(c)) {
+                error(p, QObject::tr("ожидалась запятая"));
+                return false;
+            }
+            ++p;
+            break;
+        case State::Done:
+            if (!isJsonWhitespace(c)) {
+                error(p, QObject::tr("лишние данные после массива"));
+                return false;
+            }
+            ++p;
+            break;
+        }
+    }
+    return true;
+}
+
+void TransactionParser::resume(const ResumePoint &point)
+{
+    m_state = point.afterElement ? State::AfterElement : State::BeforeFirstElement;
+    m_offset = point.offset;
+    m_resumePoint = point;
+    m_carry.clear();
+    m_errorString.clear();
+    m_errorOffset = -1;
+}
+
+bool TransactionParser::feed(QByteArrayView chunk)
+{
+    if (m_errorOffset >= 0)
+        return false;
+
+    const char *p = chunk.data();
+    const char *end = p + chunk.size();
+    const qint64 chunkOffset = m_offset;
+    m_offset += chunk.size();
+
+    if (!m_carry.isEmpty()) {
+        // Append just enough of the new chunk to finish the element, growing the
+        // window geometrically so a huge element is still parsed in linear time.
+        const qsizetype carried = m_carry.size();
+        qsizetype taken = 0;
+        for (;;) {
+            const qsizetype step = qMin<qsizetype>(end - p - taken, qMax(kCarryStep, m_carry.size()));
+            m_carry.append(p + taken, step);
+            taken += step;
+
+            m_bufferBegin = m_carry.constData();
+            m_bufferOffset = m_carryOffset;
+            const char *q = m_carry.constData();
+            const Status status = parseElement(q, q + m_carry.size());
+            if (status == Status::Error)
+                return false;
+            if (status == Status::Ok) {
+                p += (q - m_carry.constData()) - carried;
+                m_resumePoint = ResumePoint{m_carryOffset + (q - m_carry.constData()), true};
+                m_carry.clear();
+                m_state = State::AfterElement;
+                break;
+            }
+            if (p + taken == end)
+                return true;
+        }
+    }
+
+    m_bufferBegin = chunk.data();
+    m_bufferOffset = chunkOffset;
+    return parseBuffer(p, end);
+}
+
+bool TransactionParser::finish()
+{
+    if (m_errorOffset >= 0)
+        return false;
+    if (m_state != State::Done || !m_carry.isEmpty()) {
+        m_bufferBegin = nullptr;
+        m_bufferOffset = m_offset;
+        error(nullptr, QObject::tr("массив JSON не завершён"));
+        return false;
+    }
+    return true;
+}
+
+} // namespace ledger
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "ledger.h"
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+
+namespace ledger {
+
+/// Pull parser for a JSON array of {article, quantity, timestamp, hash} records.
+/// Records go into the ledger straight from the input bytes with no DOM in between;
+/// input may arrive in arbitrary chunks. Field conversions follow QJsonValue:
+/// wrong-typed or missing fields become empty/zero, unknown keys and non-object
+/// elements are validated and skipped. Timestamps stay exact 64-bit integers.
+class TransactionParser
+{
+public:
+    /// Position where parsing can pick up again once more elements are appended to
+    /// the array: just past the last complete element, or past '[' if there is none.
+    struct ResumePoint {
+        qint64 offset = -1;
+        bool afterElement = false;
+
+        bool isValid() const { return offset >= 0; }
+    };
+
+    explicit TransactionParser(Ledger &ledger);
+
+    bool feed(QByteArrayView chunk);
+    /// Checks that the array was closed.
+    bool finish();
+
+    /// Message with the byte offset of the first error, empty while parsing succeeds.
+    QString errorString() const { return m_errorString; }
+    qint64 errorOffset() const { return m_errorOffset; }
+
+    ResumePoint resumePoint() const { return m_resumePoint; }
+    /// Continues a document whose bytes before @p point were parsed earlier; the
+    /// next feed() starts at point.offset and offsets stay absolute.
+    void resume(const ResumePoint &point);
+
+private:
+    enum class State {
+        BeforeArray,
+        BeforeFirstElement,
+        BeforeElement,
+        AfterElement,
+        Done
+    };
+
+    enum class Status {
+        Ok,
+        Incomplete,
+        Error
+    };
+
+    // Fields of the element being parsed; the buffers keep their capacity between records.
+    struct PendingRecord {
+        QByteArray article;
+        QByteArray hash;
+        int quantity = 0;
+        qint64 timestamp = 0;
+    };
+
+    struct Number {
+        bool isInteger = true;
+        qint64 integer = 0;
+        double real = 0;
+    };
+
+    bool parseBuffer(const char *p, const char *end);
+    Status parseElement(const char *&p, const char *end);
+    Status parseRecord(const char *&p, const char *end);
+    Status parseString(const char *&p, const char *end, QByteArrayView &utf8);
+    Status parseNumber(const char *&p, const char *end, Number &number);
+    Status parseTimestamp(const char *&p, const char *end, qint64 &timestamp);
+    Status skipValue(const char *&p, const char *end, int depth);
+    Status error(const char *at, const QString &message);
+
+    Ledger &m_ledger;
+    PendingRecord m_record;
+    State m_state = State::BeforeArray;
+    // Stream offset of the chunk currently being parsed, for error reporting.
+    qint64 m_offset = 0;
+    const char *m_bufferBegin = nullptr;
+    qint64 m_bufferOffset = 0;
+    // An element cut by a chunk boundary is copied here and finished from the next chunk.
+    QByteArray m_carry;
+    qint64 m_carryOffset = 0;
+    // Decoded form of strings that contain escapes.
+    QByteArray m_scratch;
+    QString m_errorString;
+    qint64 m_errorOffset = -1;
+    ResumePoint m_resumePoint;
+};
+
+} // namespace ledger
@@ -0,0 +1,219 @@
+#include "crypto/ledgerkey.h"
+#include "crypto/qaesencryption.h"
+#include "ledger/ledger.h"
+#include "ledger/ledgerfile.h"
+#include "perf/trace.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFuture>
+#include <QObject>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+
+namespace {
+
+// Batch jobs tell a broken chain from a file that could not be checked at all.
+enum ExitCode {
+    ExitValid = 0,
+    ExitChainBroken = 1,
+    ExitUnreadable = 2,
+    ExitUsage = 64
+};
+
+const QStringList kLedgerFilters = {QStringLiteral("*.json"), QStringLiteral("*.enc"), QStringLiteral("*.txl")};
+
+struct FileReport {
+    QString filePath;
+    /// Set when the file could not be read; the remaining fields are then unused.
+    QString error;
+    qsizetype recordCount = 0;
+    qsizetype firstInvalid = -1;
+    QString firstInvalidArticle;
+    qint64 loadNs = 0;
+    qint64 validateNs = 0;
+    /// Read, Base64, AES, parse and validate split; empty without ENABLE_PERF_TRACE.
+    QString stages;
+};
+
+QString formatMs(qint64 nanoseconds)
+{
+    return QString::number(double(nanoseconds) / 1e6, 'f', 1);
+}
+
+QString describeError(const ledger::StreamResult &result)
+{
+    switch (result.error) {
+    case ledger::StreamError::None:
+    case ledger::StreamError::Canceled:
+        break;
+    case ledger::StreamError::Read:
+        return QObject::tr("ошибка чтения: %1").arg(result.errorString);
+    case ledger::StreamError::Decrypt:
+        return QObject::tr("не JSON и не удалось выполнить расшифровку AES-256");
+    case ledger::StreamError::Format:
+        return QObject::tr("бинарный журнал повреждён: %1").arg(result.errorString);
+    case ledger::StreamError::Json:
+        return result.encrypted ? QObject::tr("после расшифровки JSON повреждён: %1").arg(result.errorString)
+                                : QObject::tr("невалидный JSON: %1").arg(result.errorString);
+    }
+    return QString();
+}
+
+// Runs on a pool thread; validate() fans out to the global pool on its own.
+FileReport checkFile(const QAESKeySchedule &schedule, const QString &filePath)
+{
+    FileReport report;
+    report.filePath = filePath;
+
+    const quint64 since = perf::now();
+    QElapsedTimer timer;
+    timer.start();
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        report.error = QObject::tr("не удалось открыть: %1").arg(file.errorString());
+        return report;
+    }
+    ledger::Ledger records;
+    const ledger::StreamResult result = ledger::readLedgerFile(file, schedule, crypto::ledgerIv(), records);
+    report.loadNs = timer.nsecsElapsed();
+    if (result.error != ledger::StreamError::None) {
+        report.error = describeError(result);
+        return report;
+    }
+
+    timer.restart();
+    {
+        PERF_SCOPE(perf::Stage::Validate, records.size());
+        records.validate();
+    }
+    report.validateNs = timer.nsecsElapsed();
+    // Several files are checked at once, so only this thread's events belong here.
+    report.stages = perf::formatTotals(perf::summarize(perf::collectOwn(since)), QStringLiteral(", "));
+    report.recordCount = records.size();
+    report.firstInvalid = records.firstInvalid();
+    if (report.firstInvalid >= 0) {
+        report.firstInvalidArticle = records.article(report.firstInvalid);
+    }
+    return report;
+}
+
+// Expands directories into the ledger files they contain, in a stable order.
+QStringList collectFiles(const QStringList &arguments, bool recursive)
+{
+    QStringList files;
+    for (const QString &argument : arguments) {
+        if (!QFileInfo(argument).isDir()) {
+            files.append(argument);
+            continue;
+        }
+        QStringList found;
+        QDirIterator it(argument, kLedgerFilters, QDir::Files,
+                        recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+        while (it.hasNext()) {
+            found.append(it.next());
+        }
+        found.sort();
+        files.append(found);
+    }
+    return files;
+}
+
+} // namespace
+
+/// Headless validator: loads each ledger, checks its hash chain and prints the result.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("ledger_check"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QObject::tr(
+        "Проверяет цепочку хешей журналов отгрузок (.json, .enc, .txl).\n"
+        "Код возврата: 0 - все цепочки целы, 1 - есть нарушения, 2 - есть нечитаемые файлы."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("paths"), QObject::tr("Файлы журналов или каталоги с ними."),
+                                 QStringLiteral("<path>..."));
+    const QCommandLineOption jobsOption({QStringLiteral("j"), QStringLiteral("jobs")},
+                                        QObject::tr("Сколько файлов проверять одновременно."),
+                                        QStringLiteral("n"), QString::number(QThread::idealThreadCount()));
+    const QCommandLineOption recursiveOption({QStringLiteral("r"), QStringLiteral("recursive")},
+                                             QObject::tr("Искать журналы и во вложенных каталогах."));
+    parser.addOption(jobsOption);
+    parser.addOption(recursiveOption);
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    bool jobsOk = false;
+    const int jobs = parser.value(jobsOption).toInt(&jobsOk);
+    if (!jobsOk || jobs < 1) {
+        err << QObject::tr("Неверное число потоков: %1").arg(parser.value(jobsOption)) << Qt::endl;
+        return ExitUsage;
+    }
+    const QStringList files = collectFiles(parser.positionalArguments(), parser.isSet(recursiveOption));
+    if (files.isEmpty()) {
+        err << QObject::tr("Не указано ни одного журнала.") << Qt::endl << Qt::endl << parser.helpText();
+        return ExitUsage;
+    }
+
+    QElapsedTimer total;
+    total.start();
+    const QAESKeySchedule schedule(QAESEncryption::AES_256, crypto::ledgerKey());
+    QThreadPool pool;
+    pool.setMaxThreadCount(jobs);
+    const QFuture<FileReport> reports = QtConcurrent::mapped(&pool, files, [&schedule](const QString &filePath) {
+        return checkFile(schedule, filePath);
+    });
+
+    int valid = 0;
+    int broken = 0;
+    int unreadable = 0;
+    // resultAt() waits for that file only, so reports stream out in input order.
+    for (int i = 0; i < files.size(); ++i) {
+        const FileReport report = reports.resultAt(i);
+        out << report.filePath << ": ";
+        if (!report.error.isEmpty()) {
+            ++unreadable;
+            out << QObject::tr("ОШИБКА, %1").arg(report.error) << Qt::endl;
+            continue;
+        }
+        if (report.firstInvalid < 0) {
+            ++valid;
+            out << QObject::tr("OK");
+        } else {
+            ++broken;
+            out << QObject::tr("ЦЕПОЧКА НАРУШЕНА, первая неверная запись: индекс %1, артикул %2")
+                       .arg(report.firstInvalid)
+                       .arg(report.firstInvalidArticle);
+        }
+        out << QObject::tr("; записей %1, загрузка %2 мс, проверка %3 мс")
+                   .arg(report.recordCount)
+                   .arg(formatMs(report.loadNs), formatMs(report.validateNs));
+        if (!report.stages.isEmpty()) {
+            out << " (" << report.stages << ')';
+        }
+        out << Qt::endl;
+    }
+
+    out << QObject::tr("Файлов: %1, целых: %2, с нарушениями: %3, с ошибками: %4; всего %5 мс")
+               .arg(files.size())
+               .arg(valid)
+               .arg(broken)
+               .arg(unreadable)
+               .arg(formatMs(total.nsecsElapsed()))
+        << Qt::endl;
+
+    if (unreadable > 0) {
+        return ExitUnreadable;
+    }
+    return broken > 0 ? ExitChainBroken : ExitValid;
+}
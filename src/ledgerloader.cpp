@@ -0,0 +1,325 @@
+#include "ledgerloader.h"
+
+#include "crypto/qaesencryption.h"
+#include "ledger/checkpoints.h"
+#include "ledger/jsonrecordstream.h"
+#include "ledger/ledgerfile.h"
+#include "perf/trace.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QtConcurrent/QtConcurrentRun>
+
+#ifdef Q_OS_WIN
+#define NOMINMAX
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+// Records validated and handed to the view at a time: enough to keep md5Batch and
+// the thread pool busy, few enough that the first rows show up almost at once.
+constexpr qsizetype kBatchRecords = 16384;
+// Covers at least the last record, whose stored hash the next one chains to.
+constexpr qint64 kFingerprintSize = 256;
+
+QByteArray readFingerprint(QFile &file, qint64 offset)
+{
+    const qint64 from = qMax<qint64>(0, offset - kFingerprintSize);
+    if (!file.seek(from)) {
+        return QByteArray();
+    }
+    return file.read(offset - from);
+}
+
+// A file saved by writing a new one and renaming it over the old gets a new id, even
+// when size and modification time happen to match.
+quint64 fileId(QFile &file)
+{
+#ifdef Q_OS_WIN
+    const auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(file.handle()));
+    BY_HANDLE_FILE_INFORMATION info;
+    if (handle == INVALID_HANDLE_VALUE || !GetFileInformationByHandle(handle, &info)) {
+        return 0;
+    }
+    return (quint64(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+#else
+    struct stat info;
+    if (::fstat(file.handle(), &info) != 0) {
+        return 0;
+    }
+    return quint64(info.st_ino);
+#endif
+}
+} // namespace
+
+LedgerLoader::LedgerLoader(const QAESKeySchedule &schedule, const QByteArray &iv, QObject *parent)
+    : QObject(parent)
+    , m_schedule(schedule)
+    , m_iv(iv)
+{
+}
+
+LedgerLoader::~LedgerLoader()
+{
+    cancel();
+    for (QFuture<void> &worker : m_staleWorkers) {
+        worker.waitForFinished();
+    }
+    m_future.waitForFinished();
+}
+
+void LedgerLoader::cancel()
+{
+    if (m_canceled) {
+        m_canceled->store(true);
+    }
+    ++m_generation;
+}
+
+void LedgerLoader::load(const QString &filePath)
+{
+    Job job;
+    job.filePath = filePath;
+    start(std::move(job));
+}
+
+bool LedgerLoader::refresh(const ledger::Ledger &shown)
+{
+    if (m_file.filePath.isEmpty() || isLoading()) {
+        return false;
+    }
+
+    switch (detectChange()) {
+    case Change::None:
+        return false;
+    case Change::Appended:
+        loadTail(shown);
+        return true;
+    case Change::Rewritten: {
+        Job job;
+        job.filePath = m_file.filePath;
+        job.access = ledger::FileAccess::Read;
+        start(std::move(job));
+        return true;
+    }
+    }
+    return false;
+}
+
+void LedgerLoader::reopen(const QString &filePath, const ledger::Ledger &shown)
+{
+    if (!m_file.filePath.isEmpty() && !isLoading() && QFileInfo(filePath) == QFileInfo(m_file.filePath)
+        && detectChange() == Change::Appended) {
+        loadTail(shown);
+        return;
+    }
+    load(filePath);
+}
+
+LedgerLoader::Change LedgerLoader::detectChange() const
+{
+    QFile file(m_file.filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return Change::Rewritten;
+    }
+    const qint64 size = file.size();
+    const quint64 id = fileId(file);
+    if (id != m_file.fileId) {
+        return Change::Rewritten;
+    }
+    // The same size proves little: CBC padding rounds every .enc file to whole blocks,
+    // and a file edited in place keeps its id. The modification time tells them apart.
+    if (size == m_file.size && file.fileTime(QFileDevice::FileModificationTime) == m_file.modified) {
+        return Change::None;
+    }
+    if (size > m_file.size && m_file.resume.isValid()
+        && readFingerprint(file, m_file.resume.offset) == m_file.fingerprint) {
+        return Change::Appended;
+    }
+    return Change::Rewritten;
+}
+
+void LedgerLoader::loadTail(const ledger::Ledger &shown)
+{
+    Job job;
+    job.filePath = m_file.filePath;
+    job.resume = m_file.resume;
+    job.access = ledger::FileAccess::Read;
+    if (!shown.isEmpty()) {
+        job.seed = shown.mid(shown.size() - 1, 1);
+    }
+    start(std::move(job));
+}
+
+void LedgerLoader::start(Job job)
+{
+    // The old worker is not waited for: it stops at its next chunk and the generation
+    // check drops whatever it still posts. Waiting here would stall the GUI, or run a
+    // worker that has not started yet on this thread.
+    cancel();
+    m_staleWorkers.removeIf([](const QFuture<void> &worker) {
+        return worker.isFinished();
+    });
+    if (!m_future.isFinished()) {
+        m_staleWorkers.append(m_future);
+    }
+
+    if (m_following) {
+        job.access = ledger::FileAccess::Read;
+    }
+    m_canceled = std::make_shared<std::atomic_bool>(false);
+    job.canceled = m_canceled;
+    job.generation = m_generation.load();
+    emit started(job.filePath, job.resume.isValid());
+    m_future = QtConcurrent::run([this, job = std::move(job)] {
+        run(job);
+    });
+}
+
+template<typename Function>
+void LedgerLoader::post(quint64 generation, Function &&call)
+{
+    QMetaObject::invokeMethod(this, [this, generation, call = std::forward<Function>(call)]() {
+        if (generation == m_generation.load()) {
+            call();
+        }
+    }, Qt::QueuedConnection);
+}
+
+void LedgerLoader::run(const Job &job)
+{
+    if (job.canceled->load()) {
+        return;
+    }
+    const QString &filePath = job.filePath;
+    const bool appending = job.resume.isValid();
+    const auto fail = [&](const QString &title, const QString &message) {
+        post(job.generation, [this, filePath, title, message, appending] {
+            // A failed tail read keeps the shown records and the resume point, so the
+            // next refresh simply tries again; anything else starts from scratch.
+            if (!appending) {
+                m_file = FileState();
+            }
+            emit failed(filePath, title, message, appending);
+        });
+    };
+
+    QFile file(filePath);
+    if (!file.exists()) {
+        fail(tr("Файл не найден"), tr("Файл \"%1\" недоступен.").arg(filePath));
+        return;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        fail(tr("Ошибка чтения"), tr("Не удалось открыть \"%1\": %2").arg(filePath, file.errorString()));
+        return;
+    }
+
+    FileState state;
+    state.filePath = filePath;
+    state.size = file.size();
+    state.modified = file.fileTime(QFileDevice::FileModificationTime);
+    state.fileId = fileId(file);
+
+    ledger::Ledger records = job.seed;
+    const qsizetype seeded = records.size();
+    qsizetype sent = seeded;
+    // A tail is indexed from the seed rather than the file start, so only full loads
+    // use the checkpoints.
+    ledger::ValidationCheckpoints checkpoints;
+    if (!appending) {
+        PERF_SCOPE(perf::Stage::Checkpoints, 0);
+        checkpoints.load(filePath);
+    }
+    // Validates what arrived since the last batch and queues a copy for the view.
+    // Segments the checkpoints vouch for are taken as is; records of a segment that
+    // is not complete yet wait for it. A tail is sent in one piece, so a read that
+    // fails halfway adds nothing.
+    const auto flush = [&](bool force) {
+        if (!appending) {
+            PERF_SCOPE(perf::Stage::Checkpoints, 0);
+            checkpoints.restore(records);
+        }
+        const qsizetype unvalidated = records.size() - records.validatedCount();
+        if (force
+            || (!appending && unvalidated >= kBatchRecords && !checkpoints.awaitsSegment(records))) {
+            PERF_SCOPE(perf::Stage::Validate, unvalidated);
+            records.validate();
+        }
+        const qsizetype pending = records.validatedCount() - sent;
+        if (pending == 0 || (!force && pending < kBatchRecords)) {
+            return;
+        }
+        post(job.generation, [this, batch = records.mid(sent, pending)] {
+            emit batchReady(batch);
+        });
+        sent = records.validatedCount();
+    };
+    const auto report = [&](qint64 done, qint64 total) {
+        post(job.generation, [this, done, total] {
+            emit progress(done, total);
+        });
+    };
+    const auto onChunk = [&](qint64 done, qint64 total) {
+        if (job.canceled->load()) {
+            return false;
+        }
+        flush(false);
+        report(done, total);
+        return true;
+    };
+
+    const ledger::StreamResult result =
+        appending ? ledger::readJsonTail(file, job.resume, records, onChunk, job.access)
+                  : ledger::readLedgerFile(file, m_schedule, m_iv, records, onChunk, job.access);
+
+    switch (result.error) {
+    case ledger::StreamError::None:
+        break;
+    case ledger::StreamError::Canceled:
+        return;
+    case ledger::StreamError::Read:
+        fail(tr("Ошибка чтения"), tr("Не удалось прочитать \"%1\": %2").arg(filePath, result.errorString));
+        return;
+    case ledger::StreamError::Decrypt:
+        fail(tr("Ошибка формата"),
+             tr("Файл не является валидным JSON и не удалось выполнить расшифровку AES-256."));
+        return;
+    case ledger::StreamError::Format:
+        fail(tr("Ошибка формата"),
+             tr("Бинарный журнал \"%1\" повреждён: %2.").arg(filePath, result.errorString));
+        return;
+    case ledger::StreamError::Json:
+        fail(tr("Ошибка формата"),
+             result.encrypted ? tr("После расшифровки JSON повреждён: %1.").arg(result.errorString)
+                              : tr("Файл не является валидным JSON: %1.").arg(result.errorString));
+        return;
+    }
+
+    // Only a plain JSON array can be continued; .enc and .txl are reloaded in full.
+    if (result.resumePoint.isValid()) {
+        state.resume = result.resumePoint;
+        state.fingerprint = readFingerprint(file, state.resume.offset);
+    }
+
+    // A canceled load must not spend time on the last batch, nor store checkpoints
+    // while a newer load of the same file may be writing its own.
+    if (job.canceled->load()) {
+        return;
+    }
+    flush(true);
+    if (job.canceled->load()) {
+        return;
+    }
+    if (!appending) {
+        PERF_SCOPE(perf::Stage::Checkpoints, 0);
+        checkpoints.save(filePath, records);
+    }
+    post(job.generation, [this, state, count = records.size() - seeded, appending] {
+        m_file = state;
+        emit finished(state.filePath, count, appending);
+    });
+}
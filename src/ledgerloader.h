@@ -0,0 +1,114 @@
+#pragma once
+
+#include "ledger/jsonrecordstream.h"
+#include "ledger/ledger.h"
+#include "ledger/transactionparser.h"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFuture>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <memory>
+
+class QAESKeySchedule;
+
+/// Loads ledger files on a worker thread. Records are validated in batches and
+/// handed to the GUI thread as they become ready; starting another load cancels
+/// the one in progress and drops anything it still had queued.
+///
+/// After a plain JSON file has been read completely the loader remembers where the
+/// array ended, so refresh() only parses and validates records appended since.
+class LedgerLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// @p schedule and @p iv are used for .enc files and must outlive the loader.
+    LedgerLoader(const QAESKeySchedule &schedule, const QByteArray &iv, QObject *parent = nullptr);
+    /// Cancels the running load and waits for every worker, including the ones
+    /// still winding down from earlier loads.
+    ~LedgerLoader() override;
+
+    void load(const QString &filePath);
+    /// Brings @p shown, the records of the last finished load, up to date with the
+    /// file: reads only the new tail when the file grew by appending, reloads it
+    /// when it was rewritten, and does nothing when it is unchanged. Returns false if
+    /// nothing was started.
+    bool refresh(const ledger::Ledger &shown);
+    /// Loads @p filePath again because the user asked to. Only the new tail is read
+    /// when it is the file behind @p shown and it verifiably just grew; otherwise it
+    /// is loaded in full, even if it looks unchanged.
+    void reopen(const QString &filePath, const ledger::Ledger &shown);
+    void cancel();
+    /// While following, every load reads the file with read() instead of mapping it:
+    /// the file may be truncated or rewritten in the middle of the load. Tail reads
+    /// and reloads started by refresh() always do.
+    void setFollowing(bool following) { m_following = following; }
+    bool isLoading() const { return m_future.isRunning(); }
+
+signals:
+    /// Emitted before the first batch. With @p appending the batches that follow
+    /// continue the records already shown instead of replacing them.
+    void started(const QString &filePath, bool appending);
+    /// @p total is -1 when the size is not known in advance.
+    void progress(qint64 done, qint64 total);
+    /// Next validated records, in file order.
+    void batchReady(const ledger::Ledger &batch);
+    /// @p recordCount is the number of records this load added.
+    void finished(const QString &filePath, qsizetype recordCount, bool appending);
+    void failed(const QString &filePath, const QString &title, const QString &message, bool appending);
+
+private:
+    struct Job {
+        QString filePath;
+        quint64 generation = 0;
+        std::shared_ptr<std::atomic_bool> canceled;
+        /// Last record already shown, so the first new record can be chained to it.
+        ledger::Ledger seed;
+        /// Set for tail reads of a plain JSON ledger.
+        ledger::TransactionParser::ResumePoint resume;
+        ledger::FileAccess access = ledger::FileAccess::Map;
+    };
+
+    /// What is known about the file behind the records shown last.
+    struct FileState {
+        QString filePath;
+        qint64 size = -1;
+        QDateTime modified;
+        /// Inode (file index on Windows), 0 if unknown; saving by replacing changes it.
+        quint64 fileId = 0;
+        ledger::TransactionParser::ResumePoint resume;
+        /// Bytes just before resume.offset; if they changed, the file was rewritten.
+        QByteArray fingerprint;
+    };
+
+    enum class Change {
+        None,
+        Appended,
+        Rewritten
+    };
+
+    /// How the file on disk differs from m_file. Only a file with a resume point can
+    /// count as appended; any other change means it has to be read again.
+    Change detectChange() const;
+    void loadTail(const ledger::Ledger &shown);
+    void start(Job job);
+    void run(const Job &job);
+    /// Queues @p call onto the GUI thread unless a newer load has started by then.
+    template<typename Function>
+    void post(quint64 generation, Function &&call);
+
+    const QAESKeySchedule &m_schedule;
+    const QByteArray m_iv;
+    QFuture<void> m_future;
+    /// Canceled workers that have not returned yet; they still use this object.
+    QList<QFuture<void>> m_staleWorkers;
+    std::shared_ptr<std::atomic_bool> m_canceled;
+    std::atomic<quint64> m_generation{0};
+    bool m_following = false;
+    FileState m_file;
+};
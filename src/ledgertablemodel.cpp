@@ -0,0 +1,120 @@
+#include "ledgertablemodel.h"
+
+#include "perf/trace.h"
+
+#include <QBrush>
+#include <QColor>
+#include <QDateTime>
+#include <QFontDatabase>
+
+LedgerTableModel::LedgerTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+void LedgerTableModel::clear()
+{
+    beginResetModel();
+    m_ledger.clear();
+    endResetModel();
+}
+
+void LedgerTableModel::appendLedger(const ledger::Ledger &batch)
+{
+    if (batch.isEmpty()) {
+        return;
+    }
+    PERF_SCOPE(perf::Stage::View, batch.size());
+    const int first = int(m_ledger.size());
+    beginInsertRows(QModelIndex(), first, first + int(batch.size()) - 1);
+    m_ledger.append(batch);
+    endInsertRows();
+}
+
+int LedgerTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(m_ledger.size());
+}
+
+int LedgerTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant LedgerTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_ledger.size()) {
+        return QVariant();
+    }
+
+    const qsizetype row = index.row();
+    const bool validated = row < m_ledger.validatedCount();
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case ArticleColumn:
+            return m_ledger.article(row);
+        case QuantityColumn:
+            return m_ledger.quantity(row);
+        case TimestampColumn: {
+            const qint64 timestamp = m_ledger.timestamp(row);
+            return QDateTime::fromSecsSinceEpoch(timestamp, Qt::UTC)
+                       .toString(QStringLiteral("yyyy-MM-dd HH:mm:ss"))
+                   + QStringLiteral(" (%1)").arg(timestamp);
+        }
+        case StoredHashColumn:
+            return m_ledger.storedHash(row);
+        case CalculatedHashColumn:
+            return validated ? m_ledger.calculatedHash(row) : QString();
+        }
+        break;
+    case Qt::FontRole:
+        if (index.column() == StoredHashColumn || index.column() == CalculatedHashColumn) {
+            return QFontDatabase::systemFont(QFontDatabase::FixedFont);
+        }
+        break;
+    case Qt::TextAlignmentRole:
+        if (index.column() == QuantityColumn) {
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        }
+        break;
+    // Same colours the label grid used for records after a chain break.
+    case Qt::BackgroundRole:
+        if (validated && !m_ledger.chainValid(row)) {
+            return QBrush(QColor(0xff, 0xcc, 0xcc));
+        }
+        break;
+    case Qt::ForegroundRole:
+        if (validated && !m_ledger.chainValid(row)) {
+            return QBrush(QColor(0x72, 0x1c, 0x24));
+        }
+        break;
+    case ChainValidRole:
+        return !validated || m_ledger.chainValid(row);
+    }
+    return QVariant();
+}
+
+QVariant LedgerTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    if (orientation == Qt::Vertical) {
+        return section + 1;
+    }
+
+    switch (section) {
+    case ArticleColumn:
+        return tr("Артикул");
+    case QuantityColumn:
+        return tr("Количество");
+    case TimestampColumn:
+        return tr("Время отгрузки (UTC)");
+    case StoredHashColumn:
+        return tr("Хеш из файла");
+    case CalculatedHashColumn:
+        return tr("Пересчитанный хеш");
+    }
+    return QVariant();
+}
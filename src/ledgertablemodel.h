@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ledger/ledger.h"
+
+#include <QAbstractTableModel>
+
+/// Table model over a validated ledger. Cell text is produced only for the rows the
+/// view asks for, so memory does not grow with the row count.
+class LedgerTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        ArticleColumn,
+        QuantityColumn,
+        TimestampColumn,
+        StoredHashColumn,
+        CalculatedHashColumn,
+        ColumnCount
+    };
+
+    enum Role {
+        /// bool: the record is part of the intact prefix of the hash chain.
+        ChainValidRole = Qt::UserRole + 1
+    };
+
+    explicit LedgerTableModel(QObject *parent = nullptr);
+
+    void clear();
+    /// Adds validated records below the current ones.
+    void appendLedger(const ledger::Ledger &batch);
+    const ledger::Ledger &ledger() const { return m_ledger; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    ledger::Ledger m_ledger;
+};
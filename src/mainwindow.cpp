@@ -1,59 +1,40 @@
 #include "mainwindow.h"
 
+#include "crypto/ledgerkey.h"
 #include "crypto/qaesencryption.h"
+#include "ledgerloader.h"
+#include "ledgertablemodel.h"
+#include "perf/trace.h"
 
 #include <QByteArray>
-#include <QCryptographicHash>
-#include <QDateTime>
-#include <QFile>
+#include <QCheckBox>
 #include <QFileDialog>
 #include <QFileInfo>
-#include <QGridLayout>
+#include <QFileSystemWatcher>
 #include <QHBoxLayout>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonParseError>
+#include <QHeaderView>
 #include <QLabel>
-#include <QLayoutItem>
 #include <QMessageBox>
+#include <QProgressBar>
 #include <QPushButton>
-#include <QScrollArea>
+#include <QSaveFile>
 #include <QStatusBar>
-#include <QStringLiteral>
 #include <QStringList>
+#include <QStringLiteral>
+#include <QTableView>
+#include <QTimer>
 #include <QVBoxLayout>
 
 namespace {
 constexpr auto kDefaultFile = "data/transactions_generated.json.enc";
-
-const QByteArray &aesKey()
-{
-    static const QByteArray key = QByteArray::fromHex(
-        "ab9f5f69737f3f02f1e2a6d17305eae239f2bba9d6a8ed5e322ad87d3654c9d8"
-    );
-    return key;
-}
-
-const QByteArray &aesIv()
-{
-    static const QByteArray iv = QByteArray::fromHex("1af38c2dc2b96ffdd86694092341bc04");
-    return iv;
-}
-
-QLabel *createCellLabel(const QString &text, QWidget *parent = nullptr)
-{
-    auto *label = new QLabel(text, parent);
-    label->setWordWrap(true);
-    label->setMargin(6);
-    return label;
-}
 } // namespace
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
+    , m_keySchedule(QAESEncryption::AES_256, crypto::ledgerKey())
 {
     setupUi();
+    // Loading is asynchronous, so the window is shown before the default file is read.
     loadFromFile(QString::fromUtf8(kDefaultFile));
 }
 
@@ -73,26 +54,66 @@ void MainWindow::setupUi()
 
     m_openButton = new QPushButton(tr("Открыть"), this);
     toolbarLayout->addWidget(m_openButton, 0, Qt::AlignLeft);
+    m_followCheck = new QCheckBox(tr("Следить за изменениями файла"), this);
+    toolbarLayout->addWidget(m_followCheck);
     toolbarLayout->addStretch(1);
+#ifdef ENABLE_PERF_TRACE
+    m_traceButton = new QPushButton(tr("Трассировка…"), this);
+    m_traceButton->setToolTip(tr("Сохранить этапы последней загрузки в формате Chrome Trace"));
+    m_traceButton->setEnabled(false);
+    toolbarLayout->addWidget(m_traceButton);
+#endif
 
     mainLayout->addLayout(toolbarLayout);
 
-    m_scrollArea = new QScrollArea(this);
-    m_scrollArea->setWidgetResizable(true);
-
-    m_gridContainer = new QWidget(m_scrollArea);
-    m_gridLayout = new QGridLayout();
-    m_gridLayout->setContentsMargins(0, 0, 0, 0);
-    m_gridLayout->setHorizontalSpacing(12);
-    m_gridLayout->setVerticalSpacing(4);
-    m_gridContainer->setLayout(m_gridLayout);
-    m_scrollArea->setWidget(m_gridContainer);
-
-    mainLayout->addWidget(m_scrollArea, 1);
-
+    m_model = new LedgerTableModel(this);
+    m_tableView = new QTableView(this);
+    m_tableView->setModel(m_model);
+    m_tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_tableView->setWordWrap(false);
+    // Fixed row heights and column widths: sizing to contents would visit every row.
+    m_tableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_tableView->verticalHeader()->setDefaultSectionSize(m_tableView->fontMetrics().height() + 8);
+    QHeaderView *header = m_tableView->horizontalHeader();
+    header->setSectionResizeMode(QHeaderView::Interactive);
+    header->setSectionResizeMode(LedgerTableModel::StoredHashColumn, QHeaderView::Stretch);
+    header->setSectionResizeMode(LedgerTableModel::CalculatedHashColumn, QHeaderView::Stretch);
+    header->resizeSection(LedgerTableModel::TimestampColumn, 240);
+
+    mainLayout->addWidget(m_tableView, 1);
+
+    m_progressBar = new QProgressBar(this);
+    m_progressBar->setMaximumWidth(200);
+    m_progressBar->setTextVisible(false);
+    m_progressBar->hide();
+    statusBar()->addPermanentWidget(m_progressBar);
+#ifdef ENABLE_PERF_TRACE
+    m_timingLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_timingLabel);
+#endif
     statusBar()->showMessage(tr("Готово"));
 
+    m_loader = new LedgerLoader(m_keySchedule, crypto::ledgerIv(), this);
+    connect(m_loader, &LedgerLoader::started, this, &MainWindow::onLoadStarted);
+    connect(m_loader, &LedgerLoader::progress, this, &MainWindow::onLoadProgress);
+    connect(m_loader, &LedgerLoader::batchReady, m_model, &LedgerTableModel::appendLedger);
+    connect(m_loader, &LedgerLoader::finished, this, &MainWindow::onLoadFinished);
+    connect(m_loader, &LedgerLoader::failed, this, &MainWindow::onLoadFailed);
+
+    m_watcher = new QFileSystemWatcher(this);
+    // Writers usually append in several steps; wait for them to settle.
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setSingleShot(true);
+    m_refreshTimer->setInterval(250);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &MainWindow::onFileChanged);
+    connect(m_refreshTimer, &QTimer::timeout, this, &MainWindow::refreshFromFile);
+    connect(m_followCheck, &QCheckBox::toggled, this, &MainWindow::onFollowToggled);
+
     connect(m_openButton, &QPushButton::clicked, this, &MainWindow::onOpenFileRequested);
+#ifdef ENABLE_PERF_TRACE
+    connect(m_traceButton, &QPushButton::clicked, this, &MainWindow::exportTrace);
+#endif
 }
 
 void MainWindow::onOpenFileRequested()
@@ -101,7 +122,7 @@ void MainWindow::onOpenFileRequested()
         this,
         tr("Выберите файл транзакций"),
         m_currentFilePath.isEmpty() ? QString::fromUtf8(kDefaultFile) : m_currentFilePath,
-        tr("JSON или зашифрованные файлы (*.json *.enc)")
+        tr("Файлы транзакций (*.json *.enc *.txl)")
     );
 
     if (!filePath.isEmpty()) {
@@ -111,186 +132,166 @@ void MainWindow::onOpenFileRequested()
 
 void MainWindow::loadFromFile(const QString &filePath)
 {
-    QFile file(filePath);
-    if (!file.exists()) {
-        QMessageBox::warning(this, tr("Файл не найден"),
-                             tr("Файл \"%1\" недоступен.").arg(filePath));
+    if (!m_currentFilePath.isEmpty() && QFileInfo(filePath) == QFileInfo(m_currentFilePath)) {
+        m_loader->reopen(filePath, m_model->ledger());
         return;
     }
+    m_loader->load(filePath);
+}
 
-    if (!file.open(QIODevice::ReadOnly)) {
-        QMessageBox::critical(this, tr("Ошибка чтения"),
-                              tr("Не удалось открыть \"%1\": %2")
-                                  .arg(filePath, file.errorString()));
-        return;
+void MainWindow::watchFile(const QString &filePath)
+{
+    const QStringList watched = m_watcher->files();
+    if (!watched.isEmpty()) {
+        m_watcher->removePaths(watched);
     }
-
-    const QByteArray payload = file.readAll();
-    QJsonParseError parseError{};
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(payload, &parseError);
-
-    if (parseError.error != QJsonParseError::NoError || !jsonDoc.isArray()) {
-        bool decryptOk = false;
-        const QByteArray decryptedPayload = tryDecryptPayload(payload, decryptOk);
-        if (!decryptOk) {
-            QMessageBox::critical(this, tr("Ошибка формата"),
-                                  tr("Файл не является валидным JSON и не удалось выполнить расшифровку AES-256."));
-            return;
-        }
-
-        jsonDoc = QJsonDocument::fromJson(decryptedPayload, &parseError);
-        if (parseError.error != QJsonParseError::NoError || !jsonDoc.isArray()) {
-            QMessageBox::critical(this, tr("Ошибка формата"),
-                                  tr("После расшифровки JSON повреждён: %1.")
-                                      .arg(parseError.errorString()));
-            return;
-        }
+    if (m_followCheck->isChecked() && !filePath.isEmpty()) {
+        m_watcher->addPath(filePath);
     }
+}
 
-    QVector<Transaction> rawTransactions;
-    const QJsonArray jsonArray = jsonDoc.array();
-    rawTransactions.reserve(jsonArray.size());
-    for (const QJsonValue &value : jsonArray) {
-        if (!value.isObject()) {
-            continue;
-        }
-
-        const QJsonObject obj = value.toObject();
-        Transaction transaction;
-        transaction.article = obj.value(QStringLiteral("article")).toString();
-        transaction.quantity = obj.value(QStringLiteral("quantity")).toInt();
-        transaction.shipmentTimestamp = static_cast<qint64>(obj.value(QStringLiteral("timestamp")).toVariant().toLongLong());
-        transaction.storedHash = obj.value(QStringLiteral("hash")).toString();
-        rawTransactions.push_back(transaction);
+void MainWindow::onFollowToggled(bool enabled)
+{
+    m_loader->setFollowing(enabled);
+    watchFile(m_currentFilePath);
+    if (enabled) {
+        refreshFromFile();
     }
-
-    const QVector<Transaction> transactions = validateTransactions(rawTransactions);
-    renderTransactions(transactions);
-    m_currentFilePath = filePath;
-    statusBar()->showMessage(tr("Загружено записей: %1 (%2)")
-                                 .arg(transactions.size())
-                                 .arg(QFileInfo(filePath).fileName()));
 }
 
-void MainWindow::clearGrid()
+void MainWindow::onFileChanged(const QString &filePath)
 {
-    while (QLayoutItem *item = m_gridLayout->takeAt(0)) {
-        if (QWidget *widget = item->widget()) {
-            widget->deleteLater();
-        }
-        delete item;
+    // Editors that save by replacing the file make the watcher drop the path.
+    if (!m_watcher->files().contains(filePath) && QFileInfo::exists(filePath)) {
+        m_watcher->addPath(filePath);
     }
+    m_refreshTimer->start();
 }
 
-void MainWindow::renderTransactions(const QVector<Transaction> &transactions)
+void MainWindow::refreshFromFile()
 {
-    clearGrid();
-
-    const QStringList headers = {
-        tr("Артикул"),
-        tr("Количество"),
-        tr("Время отгрузки (UTC)"),
-        tr("Хеш из файла"),
-        tr("Пересчитанный хеш")
-    };
-
-    for (int column = 0; column < headers.size(); ++column) {
-        auto *headerLabel = createCellLabel(headers.at(column));
-        headerLabel->setStyleSheet(QStringLiteral("font-weight: 600;"));
-        m_gridLayout->addWidget(headerLabel, 0, column);
+    if (m_currentFilePath.isEmpty()) {
+        return;
     }
-
-    int row = 1;
-    for (const Transaction &transaction : transactions) {
-        const QString timestampText = QDateTime::fromSecsSinceEpoch(transaction.shipmentTimestamp, Qt::UTC)
-                                          .toString(QStringLiteral("yyyy-MM-dd HH:mm:ss"));
-
-        const QStringList values = {
-            transaction.article,
-            QString::number(transaction.quantity),
-            timestampText + QStringLiteral("\n(%1)").arg(transaction.shipmentTimestamp),
-            transaction.storedHash,
-            transaction.calculatedHash
-        };
-
-        for (int column = 0; column < values.size(); ++column) {
-            auto *cellLabel = createCellLabel(values.at(column));
-            if (!transaction.chainValid) {
-                cellLabel->setStyleSheet(QStringLiteral("background-color: #ffcccc; color: #721c24;"));
-            }
-            m_gridLayout->addWidget(cellLabel, row, column);
-        }
-
-        ++row;
+    if (m_loader->isLoading()) {
+        // Checked again once the current load is done.
+        m_refreshTimer->start();
+        return;
     }
+    m_loader->refresh(m_model->ledger());
+}
 
-    if (transactions.isEmpty()) {
-        auto *placeholder = createCellLabel(tr("Нет записей для отображения."));
-        placeholder->setAlignment(Qt::AlignCenter);
-        placeholder->setStyleSheet(QStringLiteral("font-style: italic;"));
-        m_gridLayout->addWidget(placeholder, 1, 0, 1, headers.size());
+void MainWindow::onLoadStarted(const QString &filePath, bool appending)
+{
+    if (!appending) {
+        m_model->clear();
+        m_currentFilePath.clear();
+        watchFile(QString());
     }
+    m_progressBar->setRange(0, 0);
+    m_progressBar->show();
+    statusBar()->showMessage(tr("Загрузка %1…").arg(QFileInfo(filePath).fileName()));
+#ifdef ENABLE_PERF_TRACE
+    m_loadStartedNs = perf::now();
+    m_timingLabel->clear();
+    m_timingLabel->setToolTip(QString());
+    m_traceButton->setEnabled(false);
+#endif
+}
 
-    for (int column = 0; column < headers.size(); ++column) {
-        m_gridLayout->setColumnStretch(column, column == headers.size() - 1 ? 2 : 1);
+void MainWindow::onLoadProgress(qint64 done, qint64 total)
+{
+    if (total <= 0) {
+        m_progressBar->setRange(0, 0);
+        return;
     }
+    constexpr int kSteps = 1000;
+    m_progressBar->setRange(0, kSteps);
+    m_progressBar->setValue(int(done * kSteps / total));
 }
 
-QVector<MainWindow::Transaction> MainWindow::validateTransactions(const QVector<Transaction> &rawTransactions) const
+void MainWindow::onLoadFinished(const QString &filePath, qsizetype recordCount, bool appending)
 {
-    QVector<Transaction> validated;
-    validated.reserve(rawTransactions.size());
-
-    QString previousHash;
-    bool chainStillValid = true;
-
-    for (Transaction transaction : rawTransactions) {
-        QByteArray payload;
-        payload.append(transaction.article.toUtf8());
-        payload.append(QByteArray::number(transaction.quantity));
-        payload.append(QByteArray::number(transaction.shipmentTimestamp));
-        payload.append(previousHash.toUtf8());
-
-        const QByteArray digest = QCryptographicHash::hash(payload, QCryptographicHash::Md5);
-        transaction.calculatedHash = QString::fromLatin1(digest.toBase64());
-
-        if (chainStillValid && transaction.storedHash != transaction.calculatedHash) {
-            chainStillValid = false;
-        }
-
-        transaction.chainValid = chainStillValid;
-        previousHash = transaction.storedHash;
-        validated.push_back(transaction);
+    m_progressBar->hide();
+    m_currentFilePath = filePath;
+    if (!appending) {
+        watchFile(filePath);
     }
-
-    return validated;
+    const QString fileName = QFileInfo(filePath).fileName();
+    if (appending) {
+        statusBar()->showMessage(tr("Добавлено записей: %1, всего %2 (%3)")
+                                     .arg(recordCount)
+                                     .arg(m_model->rowCount())
+                                     .arg(fileName));
+    } else {
+        statusBar()->showMessage(tr("Загружено записей: %1 (%2)").arg(recordCount).arg(fileName));
+    }
+#ifdef ENABLE_PERF_TRACE
+    showLoadTimings();
+#endif
 }
 
-QByteArray MainWindow::tryDecryptPayload(const QByteArray &rawPayload, bool &ok) const
+void MainWindow::onLoadFailed(const QString &filePath, const QString &title, const QString &message,
+                              bool appending)
 {
-    ok = false;
-
-    const QByteArray trimmed = QByteArray(rawPayload).trimmed();
-    if (trimmed.isEmpty()) {
-        return {};
+    m_progressBar->hide();
+    if (appending) {
+        // Most likely a write still in progress; the next change notification retries.
+        statusBar()->showMessage(tr("Не удалось дочитать %1: %2").arg(QFileInfo(filePath).fileName(), message));
+        return;
     }
+    // Rows already shown came from a file that turned out to be broken.
+    m_model->clear();
+    statusBar()->showMessage(tr("Готово"));
+    QMessageBox::critical(this, title, message);
+}
 
-    const QByteArray cipher = QByteArray::fromBase64(trimmed, QByteArray::Base64Encoding);
-    if (cipher.isEmpty() || cipher.size() % 16 != 0) {
-        return {};
-    }
+#ifdef ENABLE_PERF_TRACE
+void MainWindow::showLoadTimings()
+{
+    const quint64 elapsedNs = perf::now() - m_loadStartedNs;
+    const QVector<perf::StageTotal> totals = perf::summarize(perf::collect(m_loadStartedNs).events);
 
-    QAESEncryption aes(QAESEncryption::AES_256, QAESEncryption::CBC, QAESEncryption::PKCS7);
-    QByteArray decrypted = aes.decode(cipher, aesKey(), aesIv());
-    if (decrypted.isEmpty()) {
-        return {};
+    QStringList details;
+    for (int i = 0; i < totals.size(); ++i) {
+        const perf::StageTotal &total = totals.at(i);
+        if (total.calls == 0) {
+            continue;
+        }
+        const auto stage = perf::Stage(i);
+        QString line = tr("%1: %2 мс, вызовов %3")
+                           .arg(perf::stageName(stage), QString::number(double(total.ns) / 1e6, 'f', 1))
+                           .arg(total.calls);
+        if (perf::countsBytes(stage) && total.count > 0 && total.ns > 0) {
+            line += tr(", %1 МБ/с").arg(QString::number(double(total.count) * 1e3 / double(total.ns), 'f', 0));
+        } else if (!perf::countsBytes(stage) && total.count > 0) {
+            line += tr(", записей %1").arg(total.count);
+        }
+        details.append(line);
     }
+    // Stages run on several threads at once, so their sum may exceed the wall time.
+    const QString separator = QStringLiteral(" · ");
+    const QString stages = perf::formatTotals(totals, separator);
+    const QString wall = tr("всего %1 мс").arg(QString::number(double(elapsedNs) / 1e6, 'f', 1));
+    m_timingLabel->setText(stages.isEmpty() ? wall : stages + separator + wall);
+    m_timingLabel->setToolTip(details.join(QLatin1Char('\n')));
+    m_traceButton->setEnabled(!details.isEmpty());
+}
 
-    decrypted = QAESEncryption::RemovePadding(decrypted, QAESEncryption::PKCS7);
-    if (decrypted.isEmpty()) {
-        return {};
+void MainWindow::exportTrace()
+{
+    const QString filePath = QFileDialog::getSaveFileName(this, tr("Сохранить трассировку"),
+                                                          QStringLiteral("ledger_load.trace.json"),
+                                                          tr("Chrome Trace (*.json)"));
+    if (filePath.isEmpty()) {
+        return;
+    }
+    // QSaveFile replaces the target only once everything is written.
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || !perf::writeChromeTrace(file, perf::collect(m_loadStartedNs))
+        || !file.commit()) {
+        QMessageBox::warning(this, tr("Ошибка записи"),
+                             tr("Не удалось сохранить \"%1\": %2").arg(filePath, file.errorString()));
     }
-
-    ok = true;
-    return decrypted;
 }
+#endif
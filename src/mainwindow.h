@@ -1,13 +1,20 @@
 #pragma once
 
+#include "crypto/qaesencryption.h"
+#include "ledger/ledger.h"
+
 #include <QByteArray>
 #include <QMainWindow>
-#include <QVector>
 
-class QGridLayout;
+class LedgerLoader;
+class LedgerTableModel;
+class QCheckBox;
+class QFileSystemWatcher;
 class QLabel;
+class QProgressBar;
 class QPushButton;
-class QScrollArea;
+class QTableView;
+class QTimer;
 
 /// MainWindow renders the data page and manages loading transaction files.
 class MainWindow : public QMainWindow
@@ -21,32 +28,45 @@ public:
 private slots:
     /// Opens a file dialog for selecting a JSON data file.
     void onOpenFileRequested();
+    void onLoadStarted(const QString &filePath, bool appending);
+    void onLoadProgress(qint64 done, qint64 total);
+    void onLoadFinished(const QString &filePath, qsizetype recordCount, bool appending);
+    void onLoadFailed(const QString &filePath, const QString &title, const QString &message, bool appending);
+    /// Starts or stops following changes of the open file.
+    void onFollowToggled(bool enabled);
+    /// Re-arms the watcher and coalesces bursts of change notifications.
+    void onFileChanged(const QString &filePath);
+    /// Reads whatever the open file gained since it was last read.
+    void refreshFromFile();
 
 private:
-    struct Transaction {
-        QString article;
-        int quantity = 0;
-        qint64 shipmentTimestamp = 0;
-        QString storedHash;
-        QString calculatedHash;
-        bool chainValid = true;
-    };
-
     void setupUi();
-    /// Loads data from the provided path and refreshes the grid.
+    /// Starts loading @p filePath in the background, cancelling any load in progress.
+    /// Reopening the file already shown only reads what was appended to it.
     void loadFromFile(const QString &filePath);
-    /// Drops all views from the data grid prior to redrawing.
-    void clearGrid();
-    /// Builds the controls that represent transaction data.
-    void renderTransactions(const QVector<Transaction> &transactions);
-    /// Computes hash chain status for the provided transactions.
-    QVector<Transaction> validateTransactions(const QVector<Transaction> &rawTransactions) const;
-    /// Attempts to decrypt AES-256 payload when JSON не читается напрямую.
-    QByteArray tryDecryptPayload(const QByteArray &rawPayload, bool &ok) const;
+    void watchFile(const QString &filePath);
+#ifdef ENABLE_PERF_TRACE
+    /// Shows how long each stage of the last load took.
+    void showLoadTimings();
+    /// Saves the stages of the last load as a Chrome trace.
+    void exportTrace();
+#endif
 
     QPushButton *m_openButton = nullptr;
-    QScrollArea *m_scrollArea = nullptr;
-    QWidget *m_gridContainer = nullptr;
-    QGridLayout *m_gridLayout = nullptr;
+    QCheckBox *m_followCheck = nullptr;
+    QTableView *m_tableView = nullptr;
+    LedgerTableModel *m_model = nullptr;
+    LedgerLoader *m_loader = nullptr;
+    QProgressBar *m_progressBar = nullptr;
+    QFileSystemWatcher *m_watcher = nullptr;
+    QTimer *m_refreshTimer = nullptr;
     QString m_currentFilePath;
+#ifdef ENABLE_PERF_TRACE
+    QPushButton *m_traceButton = nullptr;
+    QLabel *m_timingLabel = nullptr;
+    /// perf::now() when the last load started; its events are the ones after it.
+    quint64 m_loadStartedNs = 0;
+#endif
+    /// Expanded once; every file load reuses it instead of re-deriving round keys.
+    const QAESKeySchedule m_keySchedule;
 };
@@ -0,0 +1,261 @@
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QIODevice>
+#include <QObject>
+#include <QStringList>
+#include <QThread>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace perf {
+namespace {
+
+// Enough for several loads of a large ledger: the pipeline records a few events per
+// 256 KiB chunk, the view one per batch.
+constexpr size_t kRingSize = 8192;
+
+// Written by its own thread and read by collect(). The lock is uncontended except
+// while a snapshot is taken, so recording stays cheap.
+struct Ring {
+    std::mutex mutex;
+    std::array<Event, kRingSize> events;
+    quint64 head = 0;
+    ThreadInfo thread;
+};
+
+class Registry
+{
+public:
+    Ring *acquire()
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        Ring *ring = nullptr;
+        if (!m_free.empty()) {
+            // A pool thread that expired left its ring behind. Its successor keeps the
+            // ring and its id, so both show up as one track in the trace.
+            ring = m_free.back();
+            m_free.pop_back();
+        } else {
+            m_rings.push_back(std::make_unique<Ring>());
+            ring = m_rings.back().get();
+            ring->thread.id = quint32(m_rings.size());
+        }
+        const std::lock_guard<std::mutex> ringLock(ring->mutex);
+        ring->thread.name = threadName(ring->thread.id);
+        return ring;
+    }
+
+    void release(Ring *ring)
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(ring);
+    }
+
+    Snapshot collect(quint64 sinceNs)
+    {
+        Snapshot snapshot;
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto &ring : m_rings) {
+            const std::lock_guard<std::mutex> ringLock(ring->mutex);
+            const quint64 first = ring->head > kRingSize ? ring->head - kRingSize : 0;
+            const qsizetype before = snapshot.events.size();
+            for (quint64 i = first; i < ring->head; ++i) {
+                const Event &event = ring->events[i % kRingSize];
+                if (event.beginNs >= sinceNs) {
+                    snapshot.events.append(event);
+                }
+            }
+            if (snapshot.events.size() > before) {
+                snapshot.threads.append(ring->thread);
+            }
+        }
+        std::sort(snapshot.events.begin(), snapshot.events.end(), [](const Event &a, const Event &b) {
+            return a.beginNs < b.beginNs;
+        });
+        return snapshot;
+    }
+
+private:
+    static QString threadName(quint32 id)
+    {
+        QThread *thread = QThread::currentThread();
+        if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+            return QStringLiteral("GUI");
+        }
+        const QString name = thread ? thread->objectName() : QString();
+        return name.isEmpty() ? QStringLiteral("Thread %1").arg(id) : QStringLiteral("%1 %2").arg(name).arg(id);
+    }
+
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<Ring>> m_rings;
+    std::vector<Ring *> m_free;
+};
+
+Registry &registry()
+{
+    // Never destroyed: threads may still record while static destructors run.
+    static Registry *instance = new Registry;
+    return *instance;
+}
+
+// Hands the thread's ring back to the registry when the thread ends.
+struct RingHolder {
+    Ring *ring = nullptr;
+    ~RingHolder()
+    {
+        if (ring) {
+            registry().release(ring);
+        }
+    }
+};
+
+Ring &threadRing()
+{
+    thread_local RingHolder holder;
+    if (!holder.ring) {
+        holder.ring = registry().acquire();
+    }
+    return *holder.ring;
+}
+
+void appendNumber(QByteArray &out, quint64 ns)
+{
+    // Chrome traces take microseconds; three decimals keep the nanoseconds.
+    out += QByteArray::number(ns / 1000);
+    out += '.';
+    out += QByteArray::number(ns % 1000).rightJustified(3, '0');
+}
+
+} // namespace
+
+QString stageName(Stage stage)
+{
+    switch (stage) {
+    case Stage::Read:
+        return QObject::tr("чтение");
+    case Stage::Base64:
+        return QStringLiteral("Base64");
+    case Stage::Decrypt:
+        return QStringLiteral("AES");
+    case Stage::Unpad:
+        return QObject::tr("снятие дополнения");
+    case Stage::Parse:
+        return QObject::tr("разбор");
+    case Stage::Checkpoints:
+        return QObject::tr("контрольные точки");
+    case Stage::Validate:
+        return QObject::tr("проверка");
+    case Stage::View:
+        return QObject::tr("таблица");
+    case Stage::Count:
+        break;
+    }
+    return QString();
+}
+
+bool countsBytes(Stage stage)
+{
+    return stage <= Stage::Parse;
+}
+
+quint64 now()
+{
+    return quint64(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                       .count());
+}
+
+void record(Stage stage, quint64 beginNs, quint64 endNs, qint64 count)
+{
+    Ring &ring = threadRing();
+    const std::lock_guard<std::mutex> lock(ring.mutex);
+    Event &event = ring.events[ring.head++ % kRingSize];
+    event.beginNs = beginNs;
+    event.endNs = endNs;
+    event.count = count;
+    event.thread = ring.thread.id;
+    event.stage = stage;
+}
+
+Snapshot collect(quint64 sinceNs)
+{
+    return registry().collect(sinceNs);
+}
+
+QVector<Event> collectOwn(quint64 sinceNs)
+{
+    Ring &ring = threadRing();
+    QVector<Event> events;
+    const std::lock_guard<std::mutex> lock(ring.mutex);
+    const quint64 first = ring.head > kRingSize ? ring.head - kRingSize : 0;
+    for (quint64 i = first; i < ring.head; ++i) {
+        const Event &event = ring.events[i % kRingSize];
+        if (event.beginNs >= sinceNs) {
+            events.append(event);
+        }
+    }
+    return events;
+}
+
+QVector<StageTotal> summarize(const QVector<Event> &events)
+{
+    QVector<StageTotal> totals(int(Stage::Count));
+    for (const Event &event : events) {
+        StageTotal &total = totals[int(event.stage)];
+        total.ns += event.endNs - event.beginNs;
+        total.count += event.count;
+        ++total.calls;
+    }
+    return totals;
+}
+
+QString formatTotals(const QVector<StageTotal> &totals, const QString &separator)
+{
+    QStringList parts;
+    for (int i = 0; i < totals.size(); ++i) {
+        if (totals.at(i).calls > 0) {
+            parts.append(QObject::tr("%1 %2 мс")
+                             .arg(stageName(Stage(i)), QString::number(double(totals.at(i).ns) / 1e6, 'f', 1)));
+        }
+    }
+    return parts.join(separator);
+}
+
+bool writeChromeTrace(QIODevice &device, const Snapshot &snapshot)
+{
+    const quint64 origin = snapshot.events.isEmpty() ? 0 : snapshot.events.first().beginNs;
+    QByteArray out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    const auto separate = [&] {
+        if (!first) {
+            out += ",\n";
+        }
+        first = false;
+    };
+    for (const ThreadInfo &thread : snapshot.threads) {
+        separate();
+        out += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" + QByteArray::number(thread.id)
+               + ",\"args\":{\"name\":\"" + thread.name.toUtf8().replace('\\', "\\\\").replace('"', "\\\"")
+               + "\"}}";
+    }
+    for (const Event &event : snapshot.events) {
+        separate();
+        out += "{\"ph\":\"X\",\"cat\":\"load\",\"name\":\"" + stageName(event.stage).toUtf8() + "\",\"pid\":1,\"tid\":"
+               + QByteArray::number(event.thread) + ",\"ts\":";
+        appendNumber(out, event.beginNs - origin);
+        out += ",\"dur\":";
+        appendNumber(out, event.endNs - event.beginNs);
+        out += countsBytes(event.stage) ? ",\"args\":{\"bytes\":" : ",\"args\":{\"records\":";
+        out += QByteArray::number(event.count) + "}}";
+    }
+    out += "\n]}\n";
+    return device.write(out) == out.size();
+}
+
+} // namespace perf
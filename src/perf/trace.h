@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+class QIODevice;
+
+/// Per-stage timing of ledger loads. Recorded only with ENABLE_PERF_TRACE; otherwise
+/// PERF_SCOPE and perf::measure() compile to nothing, so builds with tracing off pay
+/// nothing for the stages.
+namespace perf {
+
+enum class Stage : quint8 {
+    Read,
+    Base64,
+    Decrypt,
+    Unpad,
+    Parse,
+    Checkpoints,
+    Validate,
+    View,
+    Count
+};
+
+/// Short stage name for the status bar and the trace.
+QString stageName(Stage stage);
+/// Whether the stage counts bytes; the others count records.
+bool countsBytes(Stage stage);
+
+/// One timed call. @c thread is stable for the life of the recording thread.
+struct Event {
+    quint64 beginNs = 0;
+    quint64 endNs = 0;
+    qint64 count = 0;
+    quint32 thread = 0;
+    Stage stage = Stage::Count;
+};
+
+struct ThreadInfo {
+    quint32 id = 0;
+    QString name;
+};
+
+/// Events still held in the per-thread rings, ordered by start time.
+struct Snapshot {
+    QVector<Event> events;
+    QVector<ThreadInfo> threads;
+};
+
+struct StageTotal {
+    quint64 ns = 0;
+    qint64 count = 0;
+    qsizetype calls = 0;
+};
+
+/// Monotonic clock in nanoseconds, the time base of every event.
+quint64 now();
+/// Appends to the calling thread's ring; the oldest event is overwritten when full.
+void record(Stage stage, quint64 beginNs, quint64 endNs, qint64 count);
+/// Events that started at or after @p sinceNs.
+Snapshot collect(quint64 sinceNs = 0);
+/// Only the calling thread's events since @p sinceNs, for work that several
+/// threads do side by side.
+QVector<Event> collectOwn(quint64 sinceNs);
+/// Sums durations and counts per stage, indexed by Stage.
+QVector<StageTotal> summarize(const QVector<Event> &events);
+/// "name 1.2 мс" for every stage that ran, joined by @p separator.
+QString formatTotals(const QVector<StageTotal> &totals, const QString &separator);
+/// Writes @p snapshot in the Chrome trace event format (chrome://tracing, Perfetto).
+bool writeChromeTrace(QIODevice &device, const Snapshot &snapshot);
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Stage stage, qint64 count = 0)
+        : m_begin(now())
+        , m_count(count)
+        , m_stage(stage)
+    {
+    }
+
+    ~ScopedTimer() { record(m_stage, m_begin, now(), m_count); }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    const quint64 m_begin;
+    const qint64 m_count;
+    const Stage m_stage;
+};
+
+/// Calls @p function, timing it as @p stage when tracing is built in.
+template<typename Function>
+inline decltype(auto) measure(Stage stage, qint64 count, Function &&function)
+{
+#ifdef ENABLE_PERF_TRACE
+    const ScopedTimer timer(stage, count);
+#else
+    Q_UNUSED(stage);
+    Q_UNUSED(count);
+#endif
+    return function();
+}
+
+} // namespace perf
+
+#ifdef ENABLE_PERF_TRACE
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+/// Times the rest of the enclosing block as @p stage.
+#define PERF_SCOPE(stage, count) const perf::ScopedTimer PERF_CONCAT(perfScope_, __LINE__)(stage, count)
+#else
+#define PERF_SCOPE(stage, count) static_cast<void>(0)
+#endif
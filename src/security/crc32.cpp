@@ -0,0 +1,233 @@
+#include "crc32.h"
+
+#include <array>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CRC32_X86 1
+#include <immintrin.h>
+#endif
+
+namespace security {
+namespace {
+
+constexpr quint32 kPolynomial = 0xEDB88320u;
+constexpr int kSlices = 16;
+
+using Crc32Tables = std::array<std::array<quint32, 256>, kSlices>;
+
+// tables[0] is the classic byte table; tables[k][b] is the CRC of byte b followed by
+// k zero bytes, which lets 16 input bytes be folded with independent lookups.
+constexpr Crc32Tables makeTables()
+{
+    Crc32Tables tables{};
+    for (quint32 byte = 0; byte < 256; ++byte) {
+        quint32 crc = byte;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (kPolynomial & (0u - (crc & 1u)));
+        }
+        tables[0][byte] = crc;
+    }
+    for (int slice = 1; slice < kSlices; ++slice) {
+        for (int byte = 0; byte < 256; ++byte) {
+            const quint32 previous = tables[slice - 1][byte];
+            tables[slice][byte] = (previous >> 8) ^ tables[0][previous & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr Crc32Tables kTables = makeTables();
+
+// Product of two polynomials modulo the CRC polynomial, in the reflected bit order
+// of the register: bit 31 is x^0.
+constexpr quint32 multiplyModP(quint32 a, quint32 b)
+{
+    quint32 product = 0;
+    for (quint32 mask = 1u << 31; mask != 0; mask >>= 1) {
+        if (a & mask) {
+            product ^= b;
+        }
+        b = (b >> 1) ^ (kPolynomial & (0u - (b & 1u)));
+    }
+    return product;
+}
+
+// x^(2^k) modulo the polynomial. The powers repeat with period 32 in k, as in zlib.
+constexpr std::array<quint32, 32> makePowers()
+{
+    std::array<quint32, 32> powers{};
+    powers[0] = 1u << 30;
+    for (size_t k = 1; k < powers.size(); ++k) {
+        powers[k] = multiplyModP(powers[k - 1], powers[k - 1]);
+    }
+    return powers;
+}
+
+constexpr std::array<quint32, 32> kPowers = makePowers();
+
+inline quint32 loadLittleEndian32(const quint8 *data)
+{
+    return quint32(data[0]) | quint32(data[1]) << 8 | quint32(data[2]) << 16 | quint32(data[3]) << 24;
+}
+
+// Works on the inverted register, like the hardware path, so the two can be chained.
+quint32 crc32Slicing(const quint8 *data, size_t length, quint32 crc)
+{
+    const auto &t = kTables;
+    while (length >= 16) {
+        const quint32 a = loadLittleEndian32(data) ^ crc;
+        const quint32 b = loadLittleEndian32(data + 4);
+        const quint32 c = loadLittleEndian32(data + 8);
+        const quint32 d = loadLittleEndian32(data + 12);
+        crc = t[15][a & 0xFF] ^ t[14][(a >> 8) & 0xFF] ^ t[13][(a >> 16) & 0xFF] ^ t[12][a >> 24]
+              ^ t[11][b & 0xFF] ^ t[10][(b >> 8) & 0xFF] ^ t[9][(b >> 16) & 0xFF] ^ t[8][b >> 24]
+              ^ t[7][c & 0xFF] ^ t[6][(c >> 8) & 0xFF] ^ t[5][(c >> 16) & 0xFF] ^ t[4][c >> 24]
+              ^ t[3][d & 0xFF] ^ t[2][(d >> 8) & 0xFF] ^ t[1][(d >> 16) & 0xFF] ^ t[0][d >> 24];
+        data += 16;
+        length -= 16;
+    }
+    while (length >= 8) {
+        const quint32 a = loadLittleEndian32(data) ^ crc;
+        const quint32 b = loadLittleEndian32(data + 4);
+        crc = t[7][a & 0xFF] ^ t[6][(a >> 8) & 0xFF] ^ t[5][(a >> 16) & 0xFF] ^ t[4][a >> 24]
+              ^ t[3][b & 0xFF] ^ t[2][(b >> 8) & 0xFF] ^ t[1][(b >> 16) & 0xFF] ^ t[0][b >> 24];
+        data += 8;
+        length -= 8;
+    }
+    while (length--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+#ifdef CRC32_X86
+// Carry-less multiplication folding after V. Gopal et al., "Fast CRC Computation for
+// Generic Polynomials Using PCLMULQDQ Instruction" (Intel, 2009), with the
+// bit-reflected constants for the IEEE polynomial.
+#define CRC32_CLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+
+constexpr size_t kClmulMinimum = 64;
+
+alignas(16) constexpr quint64 kFold4[2] = {0x0154442bd4ull, 0x01c6e41596ull};
+alignas(16) constexpr quint64 kFold1[2] = {0x01751997d0ull, 0x00ccaa009eull};
+alignas(16) constexpr quint64 kFold64[2] = {0x0163cd6124ull, 0};
+alignas(16) constexpr quint64 kBarrett[2] = {0x01db710641ull, 0x01f7011641ull};
+
+CRC32_CLMUL_TARGET inline __m128i fold(__m128i accumulator, __m128i constants, __m128i next)
+{
+    const __m128i low = _mm_clmulepi64_si128(accumulator, constants, 0x00);
+    const __m128i high = _mm_clmulepi64_si128(accumulator, constants, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(high, low), next);
+}
+
+// @p length is a multiple of 16 and at least kClmulMinimum.
+CRC32_CLMUL_TARGET quint32 crc32Clmul(const quint8 *data, size_t length, quint32 crc)
+{
+    const auto load = [](const quint8 *p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    };
+
+    // Four independent 128-bit accumulators hide the multiplier latency.
+    __m128i x1 = _mm_xor_si128(load(data), _mm_cvtsi32_si128(int(crc)));
+    __m128i x2 = load(data + 16);
+    __m128i x3 = load(data + 32);
+    __m128i x4 = load(data + 48);
+    data += 64;
+    length -= 64;
+
+    __m128i k = _mm_load_si128(reinterpret_cast<const __m128i *>(kFold4));
+    while (length >= 64) {
+        x1 = fold(x1, k, load(data));
+        x2 = fold(x2, k, load(data + 16));
+        x3 = fold(x3, k, load(data + 32));
+        x4 = fold(x4, k, load(data + 48));
+        data += 64;
+        length -= 64;
+    }
+
+    k = _mm_load_si128(reinterpret_cast<const __m128i *>(kFold1));
+    x1 = fold(x1, k, x2);
+    x1 = fold(x1, k, x3);
+    x1 = fold(x1, k, x4);
+    while (length >= 16) {
+        x1 = fold(x1, k, load(data));
+        data += 16;
+        length -= 16;
+    }
+
+    // 128 -> 64 bits.
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    __m128i x2b = _mm_clmulepi64_si128(x1, k, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2b);
+    k = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(kFold64));
+    x2b = _mm_srli_si128(x1, 4);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x00), x2b);
+
+    // Barrett reduction to 32 bits.
+    k = _mm_load_si128(reinterpret_cast<const __m128i *>(kBarrett));
+    x2b = _mm_and_si128(x1, mask32);
+    x2b = _mm_clmulepi64_si128(x2b, k, 0x10);
+    x2b = _mm_and_si128(x2b, mask32);
+    x2b = _mm_clmulepi64_si128(x2b, k, 0x00);
+    x1 = _mm_xor_si128(x1, x2b);
+    return quint32(_mm_extract_epi32(x1, 1));
+}
+
+quint32 crc32Hybrid(const quint8 *data, size_t length, quint32 crc)
+{
+    if (length >= kClmulMinimum) {
+        const size_t bulk = length & ~size_t(15);
+        crc = crc32Clmul(data, bulk, crc);
+        data += bulk;
+        length -= bulk;
+    }
+    return crc32Slicing(data, length, crc);
+}
+#endif // CRC32_X86
+
+struct Crc32Backend {
+    const char *name;
+    quint32 (*update)(const quint8 *, size_t, quint32);
+};
+
+const Crc32Backend &selectBackend()
+{
+    static const Crc32Backend backend = []() -> Crc32Backend {
+#ifdef CRC32_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+            return {"pclmul", crc32Hybrid};
+        }
+#endif
+        return {"slicing-by-16", crc32Slicing};
+    }();
+    return backend;
+}
+
+} // namespace
+
+quint32 crc32(const void *data, size_t length, quint32 crc)
+{
+    return ~selectBackend().update(static_cast<const quint8 *>(data), length, ~crc);
+}
+
+quint32 crc32Combine(quint32 crc1, quint32 crc2, size_t length2)
+{
+    // Appending length2 bytes to A multiplies its CRC by x^(8 * length2).
+    quint32 shift = 1u << 31;
+    size_t k = 3;
+    for (size_t n = length2; n != 0; n >>= 1, ++k) {
+        if (n & 1) {
+            shift = multiplyModP(kPowers[k & 31], shift);
+        }
+    }
+    return multiplyModP(shift, crc1) ^ crc2;
+}
+
+const char *crc32Backend()
+{
+    return selectBackend().name;
+}
+
+} // namespace security
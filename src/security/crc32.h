@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <cstddef>
+
+namespace security {
+
+/// IEEE 802.3 CRC-32 (reflected polynomial 0xEDB88320), the value zlib's crc32()
+/// gives. Pass the previous result as @p crc to continue over split input.
+quint32 crc32(const void *data, size_t length, quint32 crc = 0);
+
+/// CRC32 of A followed by B, given @p crc1 = crc32(A), @p crc2 = crc32(B) and the
+/// length of B; zlib's crc32_combine(). Costs O(log length2), not a pass over B.
+quint32 crc32Combine(quint32 crc1, quint32 crc2, size_t length2);
+
+/// Name of the backend picked for this CPU at runtime.
+const char *crc32Backend();
+
+} // namespace security
@@ -0,0 +1,106 @@
+#include "guardscheduler.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+
+#include <limits>
+
+namespace security {
+namespace {
+
+// A guard due this soon is run together with the one that woke the thread.
+constexpr qint64 kMergeWindowMs = 250;
+constexpr qint64 kNeverDue = std::numeric_limits<qint64>::max();
+
+} // namespace
+
+// Lives on the scheduler thread and drives a single-shot timer there.
+class GuardScheduler::Worker : public QObject
+{
+public:
+    explicit Worker(const std::vector<std::unique_ptr<Guard>> &guards)
+        : m_guards(guards)
+        , m_due(guards.size(), 0)
+    {
+    }
+
+    void begin()
+    {
+        m_clock.start();
+        for (const auto &guard : m_guards) {
+            guard->begin();
+        }
+        m_timer = new QTimer(this);
+        m_timer->setSingleShot(true);
+        m_timer->setTimerType(Qt::CoarseTimer);
+        QObject::connect(m_timer, &QTimer::timeout, this, [this] { wake(); });
+        wake();
+    }
+
+private:
+    void wake()
+    {
+        const qint64 now = m_clock.elapsed();
+        qint64 next = kNeverDue;
+        for (size_t i = 0; i < m_guards.size(); ++i) {
+            if (m_due[i] != kNeverDue && m_due[i] <= now + kMergeWindowMs) {
+                const std::chrono::milliseconds delay = m_guards[i]->run();
+                m_due[i] = delay == Guard::kNever ? kNeverDue : m_clock.elapsed() + delay.count();
+            }
+            next = qMin(next, m_due[i]);
+        }
+        if (next != kNeverDue) {
+            m_timer->start(int(qBound<qint64>(0, next - m_clock.elapsed(), std::numeric_limits<int>::max())));
+        }
+    }
+
+    const std::vector<std::unique_ptr<Guard>> &m_guards;
+    std::vector<qint64> m_due;
+    QElapsedTimer m_clock;
+    QTimer *m_timer = nullptr;
+};
+
+GuardScheduler::GuardScheduler(QObject *parent)
+    : QObject(parent)
+{
+}
+
+GuardScheduler::~GuardScheduler()
+{
+    stop();
+}
+
+void GuardScheduler::addGuard(std::unique_ptr<Guard> guard)
+{
+    Q_ASSERT(!m_thread);
+    m_guards.push_back(std::move(guard));
+}
+
+void GuardScheduler::start()
+{
+    if (m_thread || m_guards.empty()) {
+        return;
+    }
+    m_thread = new QThread(this);
+    m_thread->setObjectName(QStringLiteral("GuardScheduler"));
+    auto *worker = new Worker(m_guards);
+    worker->moveToThread(m_thread);
+    connect(m_thread, &QThread::started, worker, [worker] { worker->begin(); });
+    connect(m_thread, &QThread::finished, worker, &QObject::deleteLater);
+    // Guards only need spare CPU time; they must never compete with the GUI.
+    m_thread->start(QThread::LowestPriority);
+}
+
+void GuardScheduler::stop()
+{
+    if (!m_thread) {
+        return;
+    }
+    m_thread->quit();
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+} // namespace security
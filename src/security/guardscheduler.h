@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QObject>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+class QThread;
+
+namespace security {
+
+/// A periodic check run on the GuardScheduler thread.
+class Guard
+{
+public:
+    /// Returned by run() when the guard has nothing more to do.
+    static constexpr std::chrono::milliseconds kNever = std::chrono::milliseconds::max();
+
+    virtual ~Guard() = default;
+
+    /// Called once on the scheduler thread before the first run().
+    virtual void begin() {}
+    /// Does one slice of work and returns the delay until the next one.
+    virtual std::chrono::milliseconds run() = 0;
+};
+
+/// Runs all guards on one low-priority thread it owns. Each guard picks its own next
+/// delay, so an idle guard can back off; the thread sleeps until the earliest one is
+/// due and then also runs any guard due shortly after, so their wakeups merge.
+class GuardScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GuardScheduler(QObject *parent = nullptr);
+    /// Stops and joins the thread, then destroys the guards.
+    ~GuardScheduler() override;
+
+    /// Takes ownership of @p guard. Must be called before start().
+    void addGuard(std::unique_ptr<Guard> guard);
+
+    void start();
+    /// Waits for the guard that may be running to finish; no guard runs afterwards.
+    void stop();
+
+private:
+    class Worker;
+
+    std::vector<std::unique_ptr<Guard>> m_guards;
+    QThread *m_thread = nullptr;
+};
+
+} // namespace security
@@ -0,0 +1,80 @@
+#include "integrityscanner.h"
+
+#include "crc32.h"
+
+namespace security {
+
+IntegrityScanner::IntegrityScanner(const QVector<CodeRegion> &regions, QObject *parent)
+    : IntegrityScanner(regions, Settings(), parent)
+{
+}
+
+IntegrityScanner::IntegrityScanner(const QVector<CodeRegion> &regions, const Settings &settings, QObject *parent)
+    : QObject(parent)
+    , m_regions(regions)
+    , m_settings(settings)
+{
+}
+
+// Runs on the scheduler thread, so the signals reach receivers in the GUI thread
+// queued. Only lays out the pages: hashing them here would stall every other guard
+// for as long as the whole code takes to read.
+void IntegrityScanner::begin()
+{
+    m_pages.clear();
+    for (qsizetype region = 0; region < m_regions.size(); ++region) {
+        const CodeRegion &code = m_regions.at(region);
+        for (size_t offset = 0; offset < code.size; offset += kPageSize) {
+            Page page;
+            page.data = code.data + offset;
+            page.size = qMin(kPageSize, code.size - offset);
+            page.region = region;
+            m_pages.append(page);
+        }
+    }
+    m_cursor = 0;
+    m_pass = 0;
+    m_baselineTaken = false;
+    m_checksum = 0;
+}
+
+std::chrono::milliseconds IntegrityScanner::run()
+{
+    if (m_pages.isEmpty()) {
+        return kNever;
+    }
+    if (m_cursor == 0) {
+        m_passClock.start();
+    }
+
+    // At least one page per slice, so a pass always finishes. The first pass takes
+    // the baseline under the same budget as the checks that follow it.
+    const qint64 budgetNs = std::chrono::nanoseconds(m_settings.tickBudget).count();
+    QElapsedTimer budget;
+    budget.start();
+    do {
+        Page &page = m_pages[m_cursor];
+        const quint32 checksum = crc32(page.data, page.size);
+        if (!m_baselineTaken) {
+            page.baseline = checksum;
+            m_checksum = crc32Combine(m_checksum, checksum, page.size);
+        } else if (!page.reported && checksum != page.baseline) {
+            page.reported = true;
+            emit tamperDetected(quintptr(page.data), page.region);
+        }
+        if (++m_cursor == m_pages.size()) {
+            m_cursor = 0;
+            if (m_baselineTaken) {
+                emit passCompleted(++m_pass);
+            } else {
+                m_baselineTaken = true;
+                emit baselineReady(m_checksum, m_pages.size());
+            }
+            const qint64 rest = m_settings.passInterval.count() - m_passClock.elapsed();
+            return std::chrono::milliseconds(qMax(rest, qint64(m_settings.tickInterval.count())));
+        }
+    } while (budget.nsecsElapsed() < budgetNs);
+    return m_settings.tickInterval;
+}
+
+} // namespace security
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "guardscheduler.h"
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include <chrono>
+
+namespace security {
+
+/// A span of mapped code to watch, usually one executable section.
+struct CodeRegion {
+    const quint8 *data = nullptr;
+    size_t size = 0;
+    /// Module or section the region belongs to, for diagnostics.
+    QString name;
+};
+
+/// Watches code regions for modification; runs as a guard on the GuardScheduler
+/// thread. The baseline is a CRC32 per page, so a change is pinned to one page.
+/// Both the baseline and the re-checks after it proceed only until each run's time
+/// budget is spent, which bounds the CPU cost per second however large the code is.
+/// Results arrive through queued signals.
+class IntegrityScanner : public QObject, public Guard
+{
+    Q_OBJECT
+
+public:
+    static constexpr size_t kPageSize = 4096;
+
+    struct Settings {
+        /// Delay between slices while a pass is in progress.
+        std::chrono::milliseconds tickInterval{100};
+        /// Hashing time allowed per slice.
+        std::chrono::microseconds tickBudget{2000};
+        /// A pass that finishes sooner waits for the rest of this interval, so small
+        /// sections are not rescanned needlessly.
+        std::chrono::milliseconds passInterval{3000};
+    };
+
+    explicit IntegrityScanner(const QVector<CodeRegion> &regions, QObject *parent = nullptr);
+    IntegrityScanner(const QVector<CodeRegion> &regions, const Settings &settings, QObject *parent = nullptr);
+
+    /// Lists the pages; the baseline is taken by the first runs.
+    void begin() override;
+    /// Hashes the next slice of pages, for the baseline or to check them.
+    std::chrono::milliseconds run() override;
+
+signals:
+    /// Emitted once the baseline of every page is taken. @p checksum is the CRC32 of
+    /// all regions in order, combined from the page checksums.
+    void baselineReady(quint32 checksum, qsizetype pageCount);
+    /// Emitted once per page whose checksum no longer matches the baseline.
+    void tamperDetected(quintptr pageAddress, qsizetype region);
+    /// Emitted after every full pass over all pages.
+    void passCompleted(quint64 pass);
+
+private:
+    struct Page {
+        const quint8 *data = nullptr;
+        size_t size = 0;
+        quint32 baseline = 0;
+        qsizetype region = 0;
+        bool reported = false;
+    };
+
+    const QVector<CodeRegion> m_regions;
+    const Settings m_settings;
+    QVector<Page> m_pages;
+    qsizetype m_cursor = 0;
+    quint64 m_pass = 0;
+    bool m_baselineTaken = false;
+    quint32 m_checksum = 0;
+    QElapsedTimer m_passClock;
+};
+
+} // namespace security
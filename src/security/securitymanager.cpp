@@ -1,21 +1,35 @@
 #include "securitymanager.h"
 
+#include "crc32.h"
+#include "guardscheduler.h"
+#include "integrityscanner.h"
+
 #include <QCoreApplication>
 #include <QDebug>
 #include <QMessageBox>
 #include <QMetaObject>
 #include <QObject>
 #include <QString>
-#include <QTimer>
 
 #include <atomic>
 #include <chrono>
 #include <cstdlib>
-#include <thread>
+#include <functional>
+#include <memory>
 
 #ifdef Q_OS_WIN
 #define NOMINMAX
 #include <windows.h>
+#include <cstring>
+#elif defined(Q_OS_LINUX)
+#include <QByteArray>
+#include <QFileInfo>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <link.h>
+#include <unistd.h>
+
 #include <cstring>
 #endif
 
@@ -25,49 +39,37 @@ namespace {
 constexpr unsigned char kIntegrityBlock[] = "ShipmentLedgerIntegrityBlock_v1";
 constexpr quint32 kIntegrityExpected = 0xBB12CCF0;
 
-quint32 crc32(const quint8 *data, size_t length)
-{
-    quint32 crc = 0xFFFFFFFFu;
-    for (size_t i = 0; i < length; ++i) {
-        crc ^= data[i];
-        for (int bit = 0; bit < 8; ++bit) {
-            const quint32 mask = -(crc & 1u);
-            crc = (crc >> 1) ^ (0xEDB88320u & mask);
-        }
-    }
-    return ~crc;
-}
-
 #ifdef Q_OS_WIN
-quint32 computeTextSectionChecksum()
+CodeRegion textSection()
 {
     const HMODULE module = GetModuleHandleW(nullptr);
     if (!module) {
-        return 0;
+        return {};
     }
 
     const auto *dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER *>(module);
     if (dosHeader->e_magic != IMAGE_DOS_SIGNATURE) {
-        return 0;
+        return {};
     }
 
     const auto *ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS *>(
         reinterpret_cast<const quint8 *>(module) + dosHeader->e_lfanew);
     if (!ntHeaders || ntHeaders->Signature != IMAGE_NT_SIGNATURE) {
-        return 0;
+        return {};
     }
 
     const IMAGE_SECTION_HEADER *section = IMAGE_FIRST_SECTION(ntHeaders);
     for (unsigned i = 0; i < ntHeaders->FileHeader.NumberOfSections; ++i, ++section) {
         if (std::memcmp(section->Name, ".text", 5) == 0) {
-            const quint8 *address = reinterpret_cast<const quint8 *>(
-                reinterpret_cast<const quint8 *>(module) + section->VirtualAddress);
-            const quint32 size = section->Misc.VirtualSize;
-            return crc32(address, size);
+            CodeRegion region;
+            region.data = reinterpret_cast<const quint8 *>(module) + section->VirtualAddress;
+            region.size = section->Misc.VirtualSize;
+            region.name = QStringLiteral(".text");
+            return region;
         }
     }
 
-    return 0;
+    return {};
 }
 
 bool isDebuggerPresentExtended()
@@ -119,7 +121,160 @@ bool isDebuggerPresentExtended()
 
     return false;
 }
-#endif // Q_OS_WIN
+
+QVector<CodeRegion> codeRegions()
+{
+    const CodeRegion text = textSection();
+    if (!text.data || text.size == 0) {
+        return {};
+    }
+    return {text};
+}
+
+class DebuggerProbe
+{
+public:
+    bool attached() const { return isDebuggerPresentExtended(); }
+};
+#elif defined(Q_OS_LINUX)
+// Executable PT_LOAD segments of the binary and of the shared libraries loaded so
+// far. Writable segments are skipped, since their contents legitimately change.
+//
+// The scanner reads these pages for the whole run, so a library must not be unmapped
+// under it by a later dlclose(): each one is first pinned with RTLD_NODELETE, and
+// libraries that are already gone by then are left out. Pinning happens outside
+// dl_iterate_phdr, which holds the loader's lock.
+QVector<CodeRegion> codeRegions()
+{
+    QVector<QByteArray> loaded;
+    dl_iterate_phdr(
+        [](dl_phdr_info *info, size_t, void *data) {
+            if (info->dlpi_name && *info->dlpi_name) {
+                static_cast<QVector<QByteArray> *>(data)->append(QByteArray(info->dlpi_name));
+            }
+            return 0;
+        },
+        &loaded);
+
+    // The main program has no name and cannot be unloaded, so it needs no pin.
+    QVector<QByteArray> pinned = {QByteArray()};
+    for (const QByteArray &name : std::as_const(loaded)) {
+        // The handle is kept on purpose; RTLD_NOLOAD never loads anything new.
+        if (dlopen(name.constData(), RTLD_LAZY | RTLD_NOLOAD | RTLD_NODELETE)) {
+            pinned.append(name);
+        }
+    }
+
+    struct Collect {
+        const QVector<QByteArray> *pinned;
+        QVector<CodeRegion> regions;
+    } collect{&pinned, {}};
+    dl_iterate_phdr(
+        [](dl_phdr_info *info, size_t, void *data) {
+            auto *collect = static_cast<Collect *>(data);
+            const QByteArray path(info->dlpi_name ? info->dlpi_name : "");
+            if (!collect->pinned->contains(path)) {
+                return 0;
+            }
+            const QString name = path.isEmpty() ? QFileInfo(QCoreApplication::applicationFilePath()).fileName()
+                                                : QFileInfo(QString::fromLocal8Bit(path)).fileName();
+            // The vDSO is supplied by the kernel rather than loaded from a file.
+            if (name.startsWith(QLatin1String("linux-vdso")) || name.startsWith(QLatin1String("linux-gate"))) {
+                return 0;
+            }
+            for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+                const ElfW(Phdr) &header = info->dlpi_phdr[i];
+                if (header.p_type != PT_LOAD || !(header.p_flags & PF_X) || (header.p_flags & PF_W)
+                    || header.p_memsz == 0) {
+                    continue;
+                }
+                // Widen to whole pages: they are mapped anyway, and the scanner's
+                // pages then line up with the real ones.
+                const quintptr begin = (info->dlpi_addr + header.p_vaddr) & ~quintptr(IntegrityScanner::kPageSize - 1);
+                const quintptr end = info->dlpi_addr + header.p_vaddr + header.p_memsz;
+                CodeRegion region;
+                region.data = reinterpret_cast<const quint8 *>(begin);
+                region.size = end - begin;
+                region.name = name;
+                collect->regions.append(region);
+            }
+            return 0;
+        },
+        &collect);
+    return collect.regions;
+}
+
+// Reads TracerPid from /proc/self/status. The file is opened once and re-read with
+// pread, so a poll costs one system call and no path lookup.
+class DebuggerProbe
+{
+public:
+    DebuggerProbe()
+        : m_fd(::open("/proc/self/status", O_RDONLY | O_CLOEXEC))
+    {
+    }
+
+    ~DebuggerProbe()
+    {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+
+    DebuggerProbe(const DebuggerProbe &) = delete;
+    DebuggerProbe &operator=(const DebuggerProbe &) = delete;
+
+    bool attached() const
+    {
+        if (m_fd < 0) {
+            return false;
+        }
+        char buffer[4096];
+        const ssize_t size = ::pread(m_fd, buffer, sizeof(buffer) - 1, 0);
+        if (size <= 0) {
+            return false;
+        }
+        buffer[size] = '\0';
+        const char *field = std::strstr(buffer, "TracerPid:");
+        return field && std::strtol(field + std::strlen("TracerPid:"), nullptr, 10) != 0;
+    }
+
+private:
+    int m_fd;
+};
+#endif
+
+#if defined(Q_OS_WIN) || defined(Q_OS_LINUX)
+// Probes for a debugger, backing off while none turns up: a clean probe doubles the
+// delay up to kMaxInterval, which keeps an idle process from waking every second.
+class DebuggerGuard : public Guard
+{
+public:
+    explicit DebuggerGuard(std::function<void()> onAttached)
+        : m_onAttached(std::move(onAttached))
+    {
+    }
+
+    std::chrono::milliseconds run() override
+    {
+        if (m_probe.attached()) {
+            m_onAttached();
+            return kNever;
+        }
+        const std::chrono::milliseconds delay = m_interval;
+        m_interval = qMin(m_interval * 2, kMaxInterval);
+        return delay;
+    }
+
+private:
+    static constexpr std::chrono::milliseconds kMinInterval{1000};
+    static constexpr std::chrono::milliseconds kMaxInterval{8000};
+
+    const DebuggerProbe m_probe;
+    const std::function<void()> m_onAttached;
+    std::chrono::milliseconds m_interval = kMinInterval;
+};
+#endif
 
 class SecurityHelper : public QObject
 {
@@ -132,17 +287,20 @@ public:
             return;
         }
 
-#ifdef Q_OS_WIN
-        m_textSectionChecksum = computeTextSectionChecksum();
-        if (m_textSectionChecksum == 0) {
+#if defined(Q_OS_WIN) || defined(Q_OS_LINUX)
+        const QVector<CodeRegion> regions = codeRegions();
+        if (regions.isEmpty()) {
             requestShutdown(QStringLiteral("Не удалось инициализировать контрольную сумму приложения."));
             return;
         }
-        qInfo().nospace() << "[Integrity] CRC32 секции .text (старт) = 0x"
-                          << QString::number(m_textSectionChecksum, 16).toUpper();
 
-        startAntiDebugThread();
-        scheduleIntegrityTimer();
+        m_scheduler.addGuard(std::make_unique<DebuggerGuard>([this] {
+            requestShutdown(QStringLiteral("Обнаружена активная отладка процесса."));
+        }));
+        m_scheduler.addGuard(createIntegrityScanner(regions));
+        // Join the guard thread while the code it reads is still mapped.
+        connect(qApp, &QCoreApplication::aboutToQuit, this, [this] { m_scheduler.stop(); });
+        m_scheduler.start();
 #endif
     }
 
@@ -164,36 +322,23 @@ private:
         return checksum == kIntegrityExpected;
     }
 
-    void scheduleIntegrityTimer()
+    std::unique_ptr<IntegrityScanner> createIntegrityScanner(const QVector<CodeRegion> &regions)
     {
-#ifdef Q_OS_WIN
-        auto *timer = new QTimer(this);
-        timer->setInterval(3000);
-        connect(timer, &QTimer::timeout, this, [this]() {
-            const auto current = computeTextSectionChecksum();
-            qInfo().nospace() << "[Integrity] CRC32 секции .text (проверка) = 0x"
-                              << QString::number(current, 16).toUpper();
-            if (current == 0 || current != m_textSectionChecksum) {
-                requestShutdown(QStringLiteral("Целостность кода нарушена."));
-            }
+        auto scanner = std::make_unique<IntegrityScanner>(regions);
+        connect(scanner.get(), &IntegrityScanner::baselineReady, this,
+                [regionCount = regions.size()](quint32 checksum, qsizetype pageCount) {
+            qInfo().nospace() << "[Integrity] CRC32 кода (старт) = 0x"
+                              << QString::number(checksum, 16).toUpper() << ", областей: " << regionCount
+                              << ", страниц: " << pageCount << " (" << crc32Backend() << ')';
         });
-        timer->start();
-#endif
-    }
-
-    void startAntiDebugThread()
-    {
-#ifdef Q_OS_WIN
-        std::thread([this]() {
-            while (!m_shutdownRequested.load(std::memory_order_acquire)) {
-                if (isDebuggerPresentExtended()) {
-                    requestShutdown(QStringLiteral("Обнаружена активная отладка процесса."));
-                    break;
-                }
-                std::this_thread::sleep_for(std::chrono::seconds(1));
-            }
-        }).detach();
-#endif
+        connect(scanner.get(), &IntegrityScanner::tamperDetected, this,
+                [this, regions](quintptr pageAddress, qsizetype region) {
+            qWarning().nospace() << "[Integrity] Изменена страница кода 0x"
+                                 << QString::number(pageAddress, 16).toUpper() << " ("
+                                 << regions.at(region).name << ')';
+            requestShutdown(QStringLiteral("Целостность кода нарушена."));
+        });
+        return scanner;
     }
 
     void requestShutdown(const QString &reason) const
@@ -209,8 +354,9 @@ private:
         }, Qt::QueuedConnection);
     }
 
-    quint32 m_textSectionChecksum = 0;
     mutable std::atomic_bool m_shutdownRequested{false};
+    // Declared last: its thread is joined before the members the guards use go away.
+    GuardScheduler m_scheduler;
 };
 
 } // namespace
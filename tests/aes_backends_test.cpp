@@ -0,0 +1,92 @@
+#include "crypto/qaesencryption.h"
+#include "testing.h"
+
+#ifdef USE_INTEL_AES_IF_AVAILABLE
+#include "crypto/aesni/aesni-common.h"
+#endif
+
+#include <QByteArray>
+#include <QRandomGenerator>
+#include <QVector>
+
+#include <cstdio>
+
+namespace {
+
+const char *const kModeNames[] = {"ECB", "CBC", "CFB", "OFB"};
+const char *const kLevelNames[] = {"AES-128", "AES-192", "AES-256"};
+
+// Around the 16-byte block, the 128-byte group of the AES-NI loops and the 256-byte
+// VAES group, plus lengths that leave every kind of tail behind a full group.
+const QVector<int> kEdgeLengths = {1,   15,  16,  17,  127, 128, 129,  255,  256,  257,
+                                   271, 383, 511, 512, 513, 1000, 4095, 4096, 4096 + 16 * 7 + 5};
+
+int keySize(QAESEncryption::Aes level)
+{
+    return 16 + 8 * int(level);
+}
+
+QByteArray randomBytes(QRandomGenerator &random, int size)
+{
+    QByteArray bytes(size, Qt::Uninitialized);
+    for (char &byte : bytes) {
+        byte = char(random.bounded(256));
+    }
+    return bytes;
+}
+
+// PKCS7 pads every length to whole blocks, so odd lengths reach the ciphers as a
+// last partial block filled up by the padding.
+void compareBackends(QAESEncryption::Aes level, QAESEncryption::Mode mode, const QByteArray &plain,
+                     const QByteArray &key, const QByteArray &iv)
+{
+    QAESEncryption software(level, mode, QAESEncryption::PKCS7);
+    software.setHardwareAcceleration(false);
+    QAESEncryption hardware(level, mode, QAESEncryption::PKCS7);
+    const QString what = QStringLiteral("%1-%2, %3 bytes")
+                             .arg(QString::fromLatin1(kLevelNames[level]), QString::fromLatin1(kModeNames[mode]))
+                             .arg(plain.size());
+
+    const QByteArray expected = software.encode(plain, key, iv);
+    if (!testing::check(!expected.isEmpty(), what + QStringLiteral(", software encode failed")))
+        return;
+    testing::check(hardware.encode(plain, key, iv) == expected, what + QStringLiteral(", encode differs"));
+    testing::check(software.removePadding(hardware.decode(expected, key, iv)) == plain,
+                   what + QStringLiteral(", hardware decode"));
+    testing::check(software.removePadding(software.decode(expected, key, iv)) == plain,
+                   what + QStringLiteral(", software decode"));
+}
+
+} // namespace
+
+int main()
+{
+#ifdef USE_INTEL_AES_IF_AVAILABLE
+    if (!check_aesni_support()) {
+        std::printf("AES-NI not supported by this CPU, skipping\n");
+        return testing::kSkipped;
+    }
+    std::printf("VAES: %s\n", check_vaes_support() ? "yes" : "no");
+#else
+    std::printf("built without USE_INTEL_AES_IF_AVAILABLE, skipping\n");
+    return testing::kSkipped;
+#endif
+
+    QRandomGenerator random(20240612);
+    const QAESEncryption::Aes levels[] = {QAESEncryption::AES_128, QAESEncryption::AES_192, QAESEncryption::AES_256};
+    const QAESEncryption::Mode modes[] = {QAESEncryption::ECB, QAESEncryption::CBC, QAESEncryption::CFB,
+                                          QAESEncryption::OFB};
+    for (const QAESEncryption::Aes level : levels) {
+        for (const QAESEncryption::Mode mode : modes) {
+            QVector<int> lengths = kEdgeLengths;
+            for (int i = 0; i < 40; ++i) {
+                lengths.append(random.bounded(8192) + 1);
+            }
+            for (const int length : lengths) {
+                compareBackends(level, mode, randomBytes(random, length), randomBytes(random, keySize(level)),
+                                randomBytes(random, 16));
+            }
+        }
+    }
+    return testing::exitCode();
+}
@@ -0,0 +1,172 @@
+#include "crypto/qaesencryption.h"
+#include "testing.h"
+
+#include <QByteArray>
+#include <QVector>
+
+#include <cstdio>
+
+namespace {
+
+struct Vector {
+    const char *name;
+    QAESEncryption::Aes level;
+    QAESEncryption::Mode mode;
+    const char *key;
+    const char *iv;
+    const char *plain;
+    const char *cipher;
+};
+
+const char kKey128[] = "2b7e151628aed2a6abf7158809cf4f3c";
+const char kKey192[] = "8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b";
+const char kKey256[] = "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4";
+const char kIv[] = "000102030405060708090a0b0c0d0e0f";
+const char kPlain[] = "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+                      "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710";
+
+// FIPS-197 Appendix C and the four-block examples of NIST SP 800-38A (F.1, F.2,
+// F.3.13-F.3.18 for CFB128, F.4).
+const Vector kVectors[] = {
+    {"FIPS-197 C.1", QAESEncryption::AES_128, QAESEncryption::ECB, "000102030405060708090a0b0c0d0e0f", "",
+     "00112233445566778899aabbccddeeff", "69c4e0d86a7b0430d8cdb78070b4c55a"},
+    {"FIPS-197 C.2", QAESEncryption::AES_192, QAESEncryption::ECB,
+     "000102030405060708090a0b0c0d0e0f1011121314151617", "", "00112233445566778899aabbccddeeff",
+     "dda97ca4864cdfe06eaf70a0ec0d7191"},
+    {"FIPS-197 C.3", QAESEncryption::AES_256, QAESEncryption::ECB,
+     "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", "", "00112233445566778899aabbccddeeff",
+     "8ea2b7ca516745bfeafc49904b496089"},
+
+    {"ECB-AES128", QAESEncryption::AES_128, QAESEncryption::ECB, kKey128, "", kPlain,
+     "3ad77bb40d7a3660a89ecaf32466ef97f5d3d58503b9699de785895a96fdbaaf"
+     "43b1cd7f598ece23881b00e3ed0306887b0c785e27e8ad3f8223207104725dd4"},
+    {"ECB-AES192", QAESEncryption::AES_192, QAESEncryption::ECB, kKey192, "", kPlain,
+     "bd334f1d6e45f25ff712a214571fa5cc974104846d0ad3ad7734ecb3ecee4eef"
+     "ef7afd2270e2e60adce0ba2face6444e9a4b41ba738d6c72fb16691603c18e0e"},
+    {"ECB-AES256", QAESEncryption::AES_256, QAESEncryption::ECB, kKey256, "", kPlain,
+     "f3eed1bdb5d2a03c064b5a7e3db181f8591ccb10d410ed26dc5ba74a31362870"
+     "b6ed21b99ca6f4f9f153e7b1beafed1d23304b7a39f9f3ff067d8d8f9e24ecc7"},
+
+    {"CBC-AES128", QAESEncryption::AES_128, QAESEncryption::CBC, kKey128, kIv, kPlain,
+     "7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b2"
+     "73bed6b8e3c1743b7116e69e222295163ff1caa1681fac09120eca307586e1a7"},
+    {"CBC-AES192", QAESEncryption::AES_192, QAESEncryption::CBC, kKey192, kIv, kPlain,
+     "4f021db243bc633d7178183a9fa071e8b4d9ada9ad7dedf4e5e738763f69145a"
+     "571b242012fb7ae07fa9baac3df102e008b0e27988598881d920a9e64f5615cd"},
+    {"CBC-AES256", QAESEncryption::AES_256, QAESEncryption::CBC, kKey256, kIv, kPlain,
+     "f58c4c04d6e5f1ba779eabfb5f7bfbd69cfc4e967edb808d679f777bc6702c7d"
+     "39f23369a9d9bacfa530e26304231461b2eb05e2c39be9fcda6c19078c6a9d1b"},
+
+    {"CFB128-AES128", QAESEncryption::AES_128, QAESEncryption::CFB, kKey128, kIv, kPlain,
+     "3b3fd92eb72dad20333449f8e83cfb4ac8a64537a0b3a93fcde3cdad9f1ce58b"
+     "26751f67a3cbb140b1808cf187a4f4dfc04b05357c5d1c0eeac4c66f9ff7f2e6"},
+    {"CFB128-AES192", QAESEncryption::AES_192, QAESEncryption::CFB, kKey192, kIv, kPlain,
+     "cdc80d6fddf18cab34c25909c99a417467ce7f7f81173621961a2b70171d3d7a"
+     "2e1e8a1dd59b88b1c8e60fed1efac4c9c05f9f9ca9834fa042ae8fba584b09ff"},
+    {"CFB128-AES256", QAESEncryption::AES_256, QAESEncryption::CFB, kKey256, kIv, kPlain,
+     "dc7e84bfda79164b7ecd8486985d386039ffed143b28b1c832113c6331e5407b"
+     "df10132415e54b92a13ed0a8267ae2f975a385741ab9cef82031623d55b1e471"},
+
+    {"OFB-AES128", QAESEncryption::AES_128, QAESEncryption::OFB, kKey128, kIv, kPlain,
+     "3b3fd92eb72dad20333449f8e83cfb4a7789508d16918f03f53c52dac54ed825"
+     "9740051e9c5fecf64344f7a82260edcc304c6528f659c77866a510d9c1d6ae5e"},
+    {"OFB-AES192", QAESEncryption::AES_192, QAESEncryption::OFB, kKey192, kIv, kPlain,
+     "cdc80d6fddf18cab34c25909c99a4174fcc28b8d4c63837c09e81700c1100401"
+     "8d9a9aeac0f6596f559c6d4daf59a5f26d9f200857ca6c3e9cac524bd9acc92a"},
+    {"OFB-AES256", QAESEncryption::AES_256, QAESEncryption::OFB, kKey256, kIv, kPlain,
+     "dc7e84bfda79164b7ecd8486985d38604febdc6740d20b3ac88f6ad82a4fb08d"
+     "71ab47a086e86eedf39d1c5bba97c4080126141d67f37be8538f5a8be740e484"},
+};
+
+const char *pathName(bool hardware)
+{
+    return hardware ? "AES-NI" : "software";
+}
+
+void checkVector(const Vector &vector, bool hardware)
+{
+    // Blocks are exact, so ZERO padding adds nothing and the ciphertext is the vector.
+    QAESEncryption cipher(vector.level, vector.mode, QAESEncryption::ZERO);
+    cipher.setHardwareAcceleration(hardware);
+    const QByteArray key = QByteArray::fromHex(vector.key);
+    const QByteArray iv = QByteArray::fromHex(vector.iv);
+    const QByteArray plain = QByteArray::fromHex(vector.plain);
+    const QByteArray cipherText = QByteArray::fromHex(vector.cipher);
+    const QString what = QStringLiteral("%1 (%2)").arg(QString::fromLatin1(vector.name),
+                                                        QString::fromLatin1(pathName(hardware)));
+
+    testing::checkEqual(cipher.encode(plain, key, iv), cipherText, what + QStringLiteral(", encode"));
+    testing::checkEqual(cipher.decode(cipherText, key, iv), plain, what + QStringLiteral(", decode"));
+
+    // Every prefix, so the software path decrypts both full groups of four blocks
+    // and the one-block tail.
+    const QAESKeySchedule schedule(vector.level, key);
+    const auto *ivBytes = reinterpret_cast<const quint8 *>(iv.constData());
+    for (qsizetype length = 16; length <= cipherText.size(); length += 16) {
+        QByteArray out(length, '\0');
+        testing::check(cipher.decrypt(schedule, reinterpret_cast<const quint8 *>(cipherText.constData()),
+                                      reinterpret_cast<quint8 *>(out.data()), length, ivBytes),
+                       what + QStringLiteral(", decrypt() rejected %1 bytes").arg(length));
+        testing::checkEqual(out, plain.left(length), what + QStringLiteral(", decrypt() of %1 bytes").arg(length));
+    }
+}
+
+// Large enough for forEachCbcSegment to split the input across the thread pool.
+void checkParallelCbc(bool hardware)
+{
+    const QByteArray key = QByteArray::fromHex(kKey256);
+    const QByteArray iv = QByteArray::fromHex(kIv);
+    QByteArray plain((1 << 20) + 3 * 16 + 16 * 1024, Qt::Uninitialized);
+    quint32 state = 0x2545f491u;
+    for (char &byte : plain) {
+        state = state * 1664525u + 1013904223u;
+        byte = char(state >> 24);
+    }
+
+    QAESEncryption cipher(QAESEncryption::AES_256, QAESEncryption::CBC, QAESEncryption::ZERO);
+    cipher.setHardwareAcceleration(hardware);
+    const QByteArray cipherText = cipher.encode(plain, key, iv);
+    const QString what = QStringLiteral("CBC %1 bytes (%2)").arg(plain.size()).arg(QString::fromLatin1(pathName(hardware)));
+    if (!testing::check(cipherText.size() == plain.size(), what + QStringLiteral(", encode")))
+        return;
+
+    // Reference: the same ciphertext in chunks below the parallel threshold, each
+    // chained to the last block of the chunk before it.
+    constexpr qsizetype kChunk = 64 * 1024;
+    QByteArray expected;
+    for (qsizetype offset = 0; offset < cipherText.size(); offset += kChunk) {
+        const QByteArray chunkIv = offset ? cipherText.mid(offset - 16, 16) : iv;
+        expected += cipher.decode(cipherText.mid(offset, kChunk), key, chunkIv);
+    }
+    testing::check(expected == plain, what + QStringLiteral(", chunked decode"));
+    testing::check(cipher.decode(cipherText, key, iv) == plain, what + QStringLiteral(", decode"));
+
+    // In place, the segments must still see the ciphertext they chain from.
+    QByteArray inPlace = cipherText;
+    const QAESKeySchedule schedule(QAESEncryption::AES_256, key);
+    cipher.decryptInPlace(schedule, reinterpret_cast<quint8 *>(inPlace.data()), inPlace.size(),
+                          reinterpret_cast<const quint8 *>(iv.constData()));
+    testing::check(inPlace == plain, what + QStringLiteral(", decryptInPlace"));
+}
+
+} // namespace
+
+int main()
+{
+    QVector<bool> paths = {false};
+    QAESEncryption probe(QAESEncryption::AES_128, QAESEncryption::ECB);
+    probe.setHardwareAcceleration(true);
+    if (probe.hardwareAcceleration()) {
+        paths.append(true);
+    } else {
+        std::printf("AES-NI not available, checking the software path only\n");
+    }
+
+    for (const bool hardware : paths) {
+        for (const Vector &vector : kVectors) {
+            checkVector(vector, hardware);
+        }
+        checkParallelCbc(hardware);
+    }
+    return testing::exitCode();
+}
@@ -0,0 +1,144 @@
+#include "ledger/binaryledger.h"
+#include "testing.h"
+
+#include <QBuffer>
+#include <QByteArray>
+#include <QtEndian>
+
+#include <cstdio>
+
+using ledger::BinaryLedgerReader;
+
+namespace {
+
+struct Record {
+    const char *article;
+    int quantity;
+    qint64 timestamp;
+    const char *hash;
+};
+
+// Packed articles and raw digests, plus one record in each exception list: an
+// article that is not all digits and hashes that are not canonical Base64.
+const Record kRecords[] = {
+    {"1000000001", 5, 1700000000, "1B2M2Y8AsgTpgAmY7PhCfg=="},
+    {"1000000002", 7, 1700000060, "not a hash"},
+    {"ART-7", 1, 1700000120, "XUFAKrxLKna5cZ2REBfFkg=="},
+    {"1000000004", 3, 1700000180, ""},
+};
+constexpr qsizetype kRecordCount = sizeof(kRecords) / sizeof(kRecords[0]);
+
+QByteArray writeImage()
+{
+    ledger::Ledger records;
+    for (const Record &record : kRecords) {
+        records.append(QByteArrayView(record.article), record.quantity, record.timestamp, QByteArrayView(record.hash));
+    }
+    QByteArray image;
+    QBuffer buffer(&image);
+    QString error;
+    if (!buffer.open(QIODevice::WriteOnly) || !ledger::writeBinaryLedger(buffer, records, &error)) {
+        testing::check(false, QStringLiteral("writeBinaryLedger failed: %1").arg(error));
+        return QByteArray();
+    }
+    buffer.close();
+    return image;
+}
+
+quint64 footerOffset(const QByteArray &image)
+{
+    return qFromLittleEndian<quint64>(image.constData() + image.size() - ledger::binary::kTrailerSize);
+}
+
+// Offset of column @p id in @p image, or 0 if the footer does not list it.
+quint64 columnOffset(const QByteArray &image, quint32 id)
+{
+    const char *footer = image.constData() + footerOffset(image);
+    const quint32 columnCount = qFromLittleEndian<quint32>(footer);
+    for (quint32 i = 0; i < columnCount; ++i) {
+        const char *entry = footer + 8 + i * 24;
+        if (qFromLittleEndian<quint32>(entry) == id)
+            return qFromLittleEndian<quint64>(entry + 8);
+    }
+    return 0;
+}
+
+void checkRoundTrip(const QByteArray &image)
+{
+    BinaryLedgerReader reader;
+    if (!testing::check(reader.open(image), QStringLiteral("open: %1").arg(reader.errorString())))
+        return;
+    if (!testing::check(reader.size() == kRecordCount, QStringLiteral("record count %1").arg(reader.size())))
+        return;
+    for (qsizetype i = 0; i < kRecordCount; ++i) {
+        const Record &record = kRecords[i];
+        testing::check(reader.article(i) == QString::fromUtf8(record.article), QStringLiteral("article %1").arg(i));
+        testing::check(reader.quantity(i) == record.quantity, QStringLiteral("quantity %1").arg(i));
+        testing::check(reader.timestamp(i) == record.timestamp, QStringLiteral("timestamp %1").arg(i));
+        testing::check(reader.storedHash(i) == QString::fromUtf8(record.hash), QStringLiteral("stored hash %1").arg(i));
+    }
+    testing::check(reader.hashDigest(0) != nullptr, QStringLiteral("canonical hash not stored raw"));
+    testing::check(reader.hashDigest(1) == nullptr, QStringLiteral("hash exception stored raw"));
+}
+
+// Footer offsets close to 2^64 used to wrap the bounds check around and pass it.
+void checkFooterOffset(const QByteArray &image)
+{
+    const quint64 offsets[] = {~quint64(0), ~quint64(0) - 3, ~quint64(0) - 7, quint64(image.size()),
+                               quint64(image.size() - ledger::binary::kTrailerSize - 7)};
+    for (const quint64 offset : offsets) {
+        QByteArray corrupted = image;
+        qToLittleEndian(offset, corrupted.data() + corrupted.size() - ledger::binary::kTrailerSize);
+        BinaryLedgerReader reader;
+        testing::check(!reader.open(corrupted),
+                       QStringLiteral("footer offset %1 accepted").arg(QString::number(offset)));
+    }
+}
+
+// A heap offset that does not leave room for the length prefix makes the value empty
+// instead of reading outside the heap; the other records are unaffected.
+void checkHeapOffset(const QByteArray &image)
+{
+    const quint64 hashExceptions = columnOffset(image, ledger::binary::HashExceptionColumn);
+    const quint64 articleExceptions = columnOffset(image, ledger::binary::ArticleExceptionColumn);
+    if (!testing::check(hashExceptions != 0 && articleExceptions != 0, QStringLiteral("exception columns missing")))
+        return;
+
+    const quint64 offsets[] = {~quint64(0), ~quint64(0) - 1, ~quint64(0) - 3, quint64(image.size())};
+    for (const quint64 offset : offsets) {
+        QByteArray corrupted = image;
+        // The first entry of each list: record 1 for hashes, record 2 for articles.
+        qToLittleEndian(offset, corrupted.data() + hashExceptions + 8);
+        qToLittleEndian(offset, corrupted.data() + articleExceptions + 8);
+        const QString what = QStringLiteral("heap offset %1").arg(QString::number(offset));
+
+        BinaryLedgerReader reader;
+        if (!testing::check(reader.open(corrupted), what + QStringLiteral(", open: %1").arg(reader.errorString())))
+            continue;
+        testing::check(reader.storedHash(1).isEmpty(), what + QStringLiteral(", hash of record 1"));
+        testing::check(reader.hashDigest(1) == nullptr, what + QStringLiteral(", digest of record 1"));
+        testing::check(reader.article(2).isEmpty(), what + QStringLiteral(", article of record 2"));
+        testing::check(reader.article(0) == QString::fromUtf8(kRecords[0].article),
+                       what + QStringLiteral(", article of record 0"));
+        testing::check(reader.storedHash(3).isEmpty(), what + QStringLiteral(", hash of record 3"));
+
+        ledger::Ledger records;
+        reader.appendTo(records);
+        testing::check(records.size() == kRecordCount, what + QStringLiteral(", appendTo"));
+    }
+}
+
+} // namespace
+
+int main()
+{
+    const QByteArray image = writeImage();
+    if (image.isEmpty())
+        return testing::exitCode();
+    std::printf("image: %lld bytes\n", static_cast<long long>(image.size()));
+
+    checkRoundTrip(image);
+    checkFooterOffset(image);
+    checkHeapOffset(image);
+    return testing::exitCode();
+}
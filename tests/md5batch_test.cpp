@@ -0,0 +1,91 @@
+#include "crypto/md5batch.h"
+#include "testing.h"
+
+#include <QCryptographicHash>
+#include <QList>
+#include <QRandomGenerator>
+#include <QVector>
+
+#include <cstdio>
+
+namespace {
+
+// Lengths around the padding edges: 55 still fits the length in one block, 56 needs
+// a second one, 64 is exactly one block of data.
+const QList<int> kEdgeLengths = {0, 1, 55, 56, 57, 63, 64, 65, 119, 120, 127, 128, 129, 200};
+
+QByteArray randomBytes(QRandomGenerator &random, int size)
+{
+    QByteArray bytes(size, Qt::Uninitialized);
+    for (char &byte : bytes) {
+        byte = char(random.bounded(256));
+    }
+    return bytes;
+}
+
+// Runs @p messages through @p backend and compares each digest with QCryptographicHash.
+void checkBatch(const QByteArray &backend, const QVector<QByteArray> &messages)
+{
+    QVector<QByteArrayView> views;
+    for (const QByteArray &message : messages) {
+        views.append(message);
+    }
+    QVector<crypto::Md5Digest> digests(messages.size());
+    if (!testing::check(crypto::md5BatchWith(backend, views.constData(), digests.data(), views.size()),
+                        QStringLiteral("backend %1 is listed but not runnable").arg(QString::fromLatin1(backend)))) {
+        return;
+    }
+    for (int i = 0; i < messages.size(); ++i) {
+        testing::checkEqual(digests.at(i).toByteArray(),
+                            QCryptographicHash::hash(messages.at(i), QCryptographicHash::Md5),
+                            QStringLiteral("%1, batch of %2, message %3 (%4 bytes)")
+                                .arg(QString::fromLatin1(backend))
+                                .arg(messages.size())
+                                .arg(i)
+                                .arg(messages.at(i).size()));
+    }
+}
+
+} // namespace
+
+int main()
+{
+    QRandomGenerator random(20240611);
+    const QList<QByteArray> backends = crypto::md5BatchBackends();
+    testing::check(!backends.isEmpty() && backends.last() == "scalar", QStringLiteral("scalar backend missing"));
+
+    for (const QByteArray &backend : backends) {
+        std::printf("md5Batch backend: %s\n", backend.constData());
+
+        // Every padding edge in every lane position.
+        QVector<QByteArray> edges;
+        for (const int length : kEdgeLengths) {
+            edges.append(randomBytes(random, length));
+        }
+        checkBatch(backend, edges);
+
+        // Batch sizes that leave partly filled vectors and a lone trailing message.
+        for (int count = 1; count <= 40; ++count) {
+            QVector<QByteArray> messages;
+            for (int i = 0; i < count; ++i) {
+                messages.append(randomBytes(random, random.bounded(201)));
+            }
+            checkBatch(backend, messages);
+        }
+    }
+
+    // The runtime pick and the single-message path.
+    for (const int length : kEdgeLengths) {
+        const QByteArray message = randomBytes(random, length);
+        testing::checkEqual(crypto::md5(message).toByteArray(),
+                            QCryptographicHash::hash(message, QCryptographicHash::Md5),
+                            QStringLiteral("md5(), %1 bytes").arg(length));
+        crypto::Md5Digest digest;
+        const QByteArrayView view(message);
+        crypto::md5Batch(&view, &digest, 1);
+        testing::checkEqual(digest.toByteArray(), QCryptographicHash::hash(message, QCryptographicHash::Md5),
+                            QStringLiteral("md5Batch(), %1 bytes").arg(length));
+    }
+
+    return testing::exitCode();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstdio>
+#include <cstdlib>
+
+/// Just enough of a harness for the test executables: failed checks are printed
+/// and counted, and main() returns exitCode().
+namespace testing {
+
+/// CTest reports a test that exits with this code as skipped.
+constexpr int kSkipped = 77;
+
+inline int &failureCount()
+{
+    static int count = 0;
+    return count;
+}
+
+inline bool check(bool condition, const QString &what)
+{
+    if (!condition) {
+        ++failureCount();
+        std::fprintf(stderr, "FAIL: %s\n", qPrintable(what));
+    }
+    return condition;
+}
+
+inline bool checkEqual(const QByteArray &actual, const QByteArray &expected, const QString &what)
+{
+    return check(actual == expected, QStringLiteral("%1: got %2, expected %3")
+                                          .arg(what, QString::fromLatin1(actual.toHex()),
+                                               QString::fromLatin1(expected.toHex())));
+}
+
+inline int exitCode()
+{
+    if (failureCount() > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", failureCount());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace testing